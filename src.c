@@ -1,21 +1,81 @@
 #define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
 #include <stdbool.h>
-
-#define MAX_NAME			20 // Max name of a player
-#define MAX_CARD_NAME		6 // The longest identifier is COLOR, its length is 0..5 + 1 space for '\0'
-#define MAX_COLOR_LEN		2 // Max length of color, i.e R,G,B,W are of length 1, we need extra slot for '\0'
+#include <stdint.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// The legal moves of a hand are found 32 or 16 cards at a time when the compiler targets AVX2 or SSE2
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TAKI_SSE2
+#endif
+
+// Counters and cycle timers of the hot paths, compiled in only with -DTAKI_INSTRUMENT, see the Instrumentation section
+#if defined(TAKI_INSTRUMENT)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define INSTR_CLOCK()		__rdtsc()
+#define INSTR_CLOCK_NAME	"rdtsc"
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define INSTR_CLOCK()		__rdtsc()
+#define INSTR_CLOCK_NAME	"rdtsc"
+#else
+#define INSTR_CLOCK()		instrNanoseconds()
+#define INSTR_CLOCK_NAME	"ns"
+#endif
+#define INSTR_COUNT(counter)			(instrLocal.counts[(counter)]++)
+#define INSTR_TIME(timer, statement)	do { uint64_t instrStart = INSTR_CLOCK(); statement; \
+    instrLocal.cycles[(timer)] += INSTR_CLOCK() - instrStart; instrLocal.calls[(timer)]++; } while (0)
+#define INSTR_MERGE()					mergeInstrumentation()
+#define INSTR_DUMP()					dumpInstrumentation(INSTR_FILE)
+#else
+#define INSTR_COUNT(counter)			((void)0)
+#define INSTR_TIME(timer, statement)	do { statement; } while (0)
+#define INSTR_MERGE()					((void)0)
+#define INSTR_DUMP()					((void)0)
+#endif
+
+#define MAX_NAME			20 // Max name of a player typed or given, the names are kept in the name pool
 #define LEN_COLOR           5 // The length of the string 'COLOR'
 
 #define WIDTH_CARD			9 // The width of the card printed to the screen
 #define LENGTH_CARD			6 // The length of the card printed to the screen
+#define CARD_CODES			128 // The amount of values a packed card can have, the size of the glyph cache
+#define CARD_GAP			"  " // The space between two cards printed side by side
+#define FRAME_INIT_CAPACITY	4096 // The initial size of the buffer of a frame, it doubles when a frame doesn't fit
+#define ARENA_INIT_CAPACITY	1024 // The initial amount of cards in the arena of the hands
+#define HAND_MAX			65535 // The max amount of cards in a hand, the size is counted in 16 bits
+#define NAME_BLOCK			4096 // The size of each block of the name pool
+#define NAME_INIT_SLOTS		256 // The initial size of the hash table of the name pool, a power of two
+#define LIVE_DEFAULT_CARDS	7 // The amount of cards side by side in the live display
+#define LIVE_TOP_LINE		3 // The first line of the top card in the live display
+#define LIVE_BANNER_LINE	(LIVE_TOP_LINE + LENGTH_CARD + 1) // The line naming the current player
+#define LIVE_FIRST_SEAT		(LIVE_BANNER_LINE + 2) // The line of the first seat, every seat has one line with the size of its hand
+#define LIVE_ROW_LINES		(LENGTH_CARD + 2) // A title, the card and an empty line
 
 #define INIT_QUAN			4 // The initial quantity of card for each player
 #define FIRST_PLAYER		0 // The index of the first player
+#define NO_WINNER			-1 // Returned by gameLoop for a game that ended in PHASE_GAME_DRAWN
 #define INIT_HISTO          0
 
 // Tokens for each card, and one for indicating that the player drew a card from the deck.
@@ -26,8 +86,28 @@
 #define TOKEN_CHANGE_COL	14
 #define TOKEN_REG			15
 #define TOKEN_FROM_DEC		16
-
-// Enumeration for each color
+#define TOKEN_FIRST			TOKEN_PLUS // The first token, turnRules is indexed from it
+#define NUM_OF_TOKENS		7
+
+// The phases of a turn, the phase of a game tells step what the next action of the current player is
+#define PHASE_PICK_CARD		0 // Placing a card or drawing one
+#define PHASE_TAKI_PICK		1 // Placing another card of a TAKI run, or drawing one to end the run
+#define PHASE_PICK_COLOR	2 // Picking the colour of the COLOR card just placed
+#define PHASE_GAME_OVER		3 // The current player won
+#define PHASE_GAME_DRAWN	4 // Nobody won, a card had to be drawn when both piles of the finite deck were empty
+
+// What a player emptying his hand with a card does, see TurnRule
+#define LAST_CARD_WINS		0
+#define LAST_CARD_DRAWS		1 // He can't finish with the card, he draws a card and the turn passes
+#define LAST_CARD_DRAWS_2P	2 // The same, but only in a game of two players
+
+// What a card does when it's placed inside a TAKI run, see TurnRule
+#define RUN_CONTINUE		0 // The run goes on
+#define RUN_END_LAST		1 // The run ends with the rule of the last card placed in it
+#define RUN_END				2 // The run ends with the rule of this card
+
+// Enumeration for each color, 0 is kept for the COLOR card which has no color
+#define NO_COLOR			0
 #define COLOR_Y			    1
 #define COLOR_R				2
 #define COLOR_B				3
@@ -40,141 +120,1153 @@
 #define STR_TAKI			"TAKI"
 #define STR_CHANGE_COL		"COLOR"
 
-// Char identifiers for each card number and the first letter of each type
-#define CARD_1              '1'
-#define CARD_2              '2'
-#define CARD_3              '3'
-#define CARD_4              '4'
-#define CARD_5              '5'
-#define CARD_6              '6'
-#define CARD_7              '7'
-#define CARD_8              '8'
-#define CARD_9              '9'
-#define CARD_PLUS           '+'
-#define CARD_STOP           'S'
-#define CARD_CH_DIR         '<'
-#define CARD_CH_COL         'C'
-#define CARD_TAKI           'T'
-
-#define ZERO_CHAR			'0' // For converting numerical value to char
-#define NO_COLOR			'\0' // Used when the color card is initialized, it has no color, used in the prinitng function for printing blank
-#define NULL_CHAR			'\0' // String termination char
+// The kind of each card, it is also the index of the card in the histogram
+#define KIND_1				0
+#define KIND_2				1
+#define KIND_3				2
+#define KIND_4				3
+#define KIND_5				4
+#define KIND_6				5
+#define KIND_7				6
+#define KIND_8				7
+#define KIND_9				8
+#define KIND_PLUS			9
+#define KIND_STOP			10
+#define KIND_CHANGE_DIR		11
+#define KIND_TAKI			12
+#define KIND_CHANGE_COL		13
+
+// A card is packed into one byte, bits 0 - 3 hold the kind and bits 4 - 6 hold the color
+#define CARD_KIND_MASK		0x0F
+#define CARD_COLOR_SHIFT	4
+#define CARD_KIND(card)		((card) & CARD_KIND_MASK)
+#define CARD_COLOR(card)	((card) >> CARD_COLOR_SHIFT)
+#define MAKE_CARD(kind, color)	((Card)((kind) | ((color) << CARD_COLOR_SHIFT)))
+
+// Flags describing the legality of each kind of card
+#define KIND_FLAG_WILD		0x01 // Has no color, the built-in rules let it be placed on any card and inside a TAKI run of any color
+#define MASK_CARDS			64 // The amount of cards covered by one legal move mask
+
+#define SNAPSHOT_MAX_PLAYERS	8 // The max amount of players of a game that fits in a snapshot
+#define SNAPSHOT_MAX_CARDS	256 // The max amount of cards in all the hands of a game that fits in a snapshot
+
+#define RECORD_MAGIC		"TAKIREC1" // The first bytes of a record file
+#define RECORD_MAGIC_LEN	8
+#define RECORD_BLOCK		(1 << 20) // A recorder appends its games to the file once it holds this many bytes
+#define RECORD_MAX_PLAYERS	255 // The amount of players of a recorded game is kept in one byte
+
+// The counters and the timers of the instrumentation
+#define INSTR_DECK_REALLOC	0 // Hands that outgrew their capacity
+#define INSTR_TAKI_RUNS		1 // TAKI runs started
+#define INSTR_TAKI_CARDS	2 // Cards placed inside TAKI runs
+#define INSTR_RETRIES		3 // Invalid choices, asked again or turned into drawing a card
+#define INSTR_COUNTERS		4
+#define INSTR_RENDER		0 // Drawing the screen
+#define INSTR_DECIDE		1 // Reading the action, from the strategy or the user
+#define INSTR_RULES			2 // Applying the action with step
+#define INSTR_TIMERS		3
+#define INSTR_FILE			"instrument.json" // The JSON summary is written here at exitGame
+
+#define CACHE_LINE			64 // The size of a cache line, data written by different threads is kept this far apart
+#define TRACE_RING_SIZE		(1 << 16) // The amount of events the ring of a tracer holds, a power of two
+#define TRACE_DRAIN_BATCH	1024 // The max amount of events the drain thread writes at once
+#define TRACE_LINE_MAX		48 // The max length of the line of one event in the trace file
+#define TRACE_IDLE_NS		200000 // How long the drain thread sleeps when the ring is empty
+#define TRACE_DROP			0 // A full ring drops the event and counts it
+#define TRACE_BLOCK			1 // A full ring makes the game wait until the drain thread makes room
+
+// The events of a record, one byte each. Placing a card is the card itself (0x00 - 0x7F)
+#define EVENT_DRAW			0x80 // + the card drawn
+#define EVENT_COLOR			0xF0 // + the colour picked, NO_COLOR if the pick was invalid
+#define EVENT_TAKI_END		0xF9 // The end of a TAKI run
+#define EVENT_GAME_END		0xFD // Followed by the winner
+#define EVENT_GAME			0xFE // Followed by the seed, the amount of players, the top card and every hand (its size, then its cards)
 
 #define ERROR_OK			0 // The operation succeeded
 #define ERROR_INVALID		1 // The opeartion failed
 #define CARDS_RANGE			14 // 1 - 9, TAKI, <->, +, COLOR, STOP
-
-#define CASE_CARD_1 0
-#define CASE_CARD_2 1
-#define CASE_CARD_3 2
-#define CASE_CARD_4 3
-#define CASE_CARD_5 4
-#define CASE_CARD_6 5
-#define CASE_CARD_7 6
-#define CASE_CARD_8 7
-#define CASE_CARD_9 8
-#define CASE_CARD_10 9
-#define CASE_CARD_11 10
-#define CASE_CARD_12 11
-#define CASE_CARD_13 12
-#define CASE_CARD_14 13
+#define KIND_CODES			16 // The amount of values the kind of a packed card can have, the size of a row of legalTable
+
+#define RULES_MAX_LINE		256 // The max length of a line of a rule set file
+#define OPTIONS_MAX_LINE	256 // The max length of a line of a config file, and of the path of a script
+#define RULES_MAX_DEAL		64 // The max amount of cards dealt to each player
+#define RULES_MAX_ADVANCE	2 // The max amount of seats a turn moves, the lockstep batches wrap the seat once
+#define DECK_COPIES			2 // The copies of every coloured card in a finite deck, of each colour
+#define DECK_WILD_COPIES	4 // The copies of the COLOR card in a finite deck
+#define DECK_MAX_CARDS		4096 // The max size of a finite deck
+
+#define BOT_NAME			"Bot" // Prefix of the names given to the players of a headless simulation
+#define SIM_DEFAULT_GAMES	1000000 // The amount of games played by --simulate when none is given
+#define SIM_DEFAULT_PLAYERS	4 // The amount of players in each simulated game when none is given
+#define TABLE_DEFAULT_SEATS	1000 // The amount of seats of a --table game when none is given
+#define TABLE_DEFAULT_GAMES	100 // The amount of games played by --table when none is given
+
+#define SKETCH_SUB_BITS		4 // A quantile sketch splits every power of two into 2^SKETCH_SUB_BITS buckets, a quantile is off by at most 1/32
+#define SKETCH_EXACT		(2 << SKETCH_SUB_BITS) // The values below it have a bucket each
+#define SKETCH_BUCKETS		1024 // Enough buckets for any value of a long long
+#define STATS_FLIP_GROUPS	8 // The games are grouped by their rotation flips, the last group has this many flips or more
+#define STATS_CSV_SUFFIX	".csv" // A --stats file ending with it is written as CSV, any other as JSON
+
+#define TOURNAMENT_CHUNK	1024 // The amount of games in each task of a tournament, a worker steals whole tasks
+#define MAX_STRATEGIES		8 // The max amount of different strategies taking part in a tournament
+#define MAX_THREADS			256 // The max amount of worker threads of a tournament
+#define MAX_PLAYERS_LINEUP	64 // The max amount of players in each game of a tournament
+#define TASK_EMPTY			-1 // Returned from a work queue that has no tasks left
+#define TASK_ABORT			-2 // Returned from a steal that lost a race, the queue may still have tasks
+#define PROGRESS_DEFAULT_MS	1000 // How often --progress prints the results of a tournament so far when no interval is given, in milliseconds
+#define PROGRESS_POLL_NS	20000000 // How often the progress thread checks if the tournament is over
+
+#define ISMCTS_DEFAULT_MS	100 // The time budget of each move of the ISMCTS player when none is given, in milliseconds
+#define ISMCTS_MAX_NODES	65536 // The size of the node pool of each search thread, a full pool stops growing the tree
+#define ISMCTS_MAX_DEPTH	64 // The max amount of tree nodes a single playout goes through
+#define ISMCTS_EXPLORATION	0.7 // The exploration constant of the UCB formula
+#define NO_NODE				-1 // An empty link between nodes, also marks a playout that left the tree
+
+// The actions of the search tree, placing a card is the packed card itself so it doesn't depend on the order of the hand
+#define ACTION_DRAW			0x80
+#define ACTION_COLOR		0x100 // Added to the colour for choosing a colour
+#define ACTION_RANGE		(ACTION_COLOR + COLOR_G + 1)
+#define NO_ACTION			-1 // Returned from a search of a position that doesn't fit in a snapshot
+#define ISMCTS_TABLE_BITS	18 // The transposition table of an ISMCTS player has 2^ISMCTS_TABLE_BITS entries
+#define ISMCTS_TABLE_PRIOR	16 // The max amount of playouts a new node takes from the transposition table
+#define ZOBRIST_STATE		(1ull << 63) // Marks the index of the key of the state of the game, see zobristKey
+#define ZOBRIST_ACTION		(1ull << 62) // Marks the index of the key of an action
+#define ZOBRIST_SIZE		(1ull << 61) // Marks the index of the key of the size of a hand, see sizeKey
+
+#define BENCH_DEFAULT_GAMES	20000 // The amount of games of each workload of --bench when none is given
+#define BENCH_MAX_PLAYERS	8 // The max amount of players of a workload
+#define BENCH_POSITIONS		2048 // The amount of positions kept from each workload for timing the functions
+#define BENCH_SAMPLE_EVERY	7 // A position is kept from every this many moves
+#define BENCH_REPEATS		8 // The amount of times each function is timed in each position
+#define BENCH_FUNCTIONS		5 // The amount of functions timed
+#define BENCH_BATCH			16 // The amount of calls timed together, reading the clock costs about as much as one call
+
+#define SELFTEST_DEFAULT_HANDS	1000000 // The amount of random hands --selftest checks when none is given
+#define SELFTEST_MAX_OFFSET	32 // A hand starts at a random offset below it in the buffer, so the vector loads are unaligned too
+
+#define BATCH_DEFAULT_LANES	64 // The amount of games a --batch run advances together when none is given
+#define BATCH_MAX_LANES		256
+#define BATCH_MAX_PLAYERS	16 // The max amount of players of the games of a batch
+#define BATCH_GROUP			16 // The lanes are looped over in groups of this many, the amount of lanes is rounded up to a whole group
+#define NO_TOKEN			0 // The turn of a lane goes on, there is no turn rule to apply this round
 
 // Typedefs for making the code a bit more redable, regarding the return type of several functions
 typedef int errorCode;
 typedef int token;
 
-typedef struct card {
-    char colour; // Can be R | G | B | Y | or none
-    char type[MAX_CARD_NAME]; // Can be 1 - 9 | + | STOP | <-> | COLOR | TAKI
-} Card;
+typedef unsigned char Card; // Built with MAKE_CARD, the kind can be 1 - 9 | + | STOP | <-> | TAKI | COLOR, the color can be Y | R | B | G | or none
+
+// Lookup tables indexed by the kind of a card, strings are only used when printing.
+const token cardToken[CARDS_RANGE] = {
+    TOKEN_REG, TOKEN_REG, TOKEN_REG, TOKEN_REG, TOKEN_REG, TOKEN_REG, TOKEN_REG, TOKEN_REG, TOKEN_REG,
+    TOKEN_PLUS, TOKEN_STOP, TOKEN_CHANGE_DIR, TOKEN_TAKI, TOKEN_CHANGE_COL
+};
+const char* cardTypeStr[CARDS_RANGE] = {
+    "1", "2", "3", "4", "5", "6", "7", "8", "9",
+    STR_PLUS, STR_STOP, STR_CHANGE_DIR, STR_TAKI, STR_CHANGE_COL
+};
+const unsigned char kindFlags[CARDS_RANGE] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, KIND_FLAG_WILD
+};
+const char colourChar[COLOR_G + 1] = { ' ', 'Y', 'R', 'B', 'G' }; // Indexed by the color, NO_COLOR is printed as blank
+
+/*
+    The rule of a token, applied by step when a turn ends with it. The columns are what the token does in each phase:
+    ending a turn (nextPhase, advance, reverse, lastCard) or placed inside a TAKI run (inRun).
+*/
+
+typedef struct turnRule {
+    unsigned char nextPhase; // PHASE_PICK_CARD when the turn passes, or the phase the same player continues with
+    unsigned char advance; // The amount of seats the turn moves
+    bool reverse; // The rotation is reversed before the turn moves
+    unsigned char lastCard; // LAST_CARD_*
+    unsigned char inRun; // RUN_*
+} TurnRule;
+
+// The built-in rules, indexed by the token - TOKEN_FIRST. A rule set starts from them.
+const TurnRule defaultTurnRules[NUM_OF_TOKENS] = {
+    { PHASE_PICK_CARD, 0, false, LAST_CARD_DRAWS, RUN_CONTINUE }, // +, another turn
+    { PHASE_PICK_CARD, 2, false, LAST_CARD_DRAWS_2P, RUN_CONTINUE }, // STOP, the next player is skipped
+    { PHASE_PICK_CARD, 1, true, LAST_CARD_WINS, RUN_CONTINUE }, // <->
+    { PHASE_TAKI_PICK, 0, false, LAST_CARD_WINS, RUN_CONTINUE }, // TAKI, a run of its colour starts
+    { PHASE_PICK_COLOR, 0, false, LAST_CARD_WINS, RUN_END }, // COLOR, the turn passes once the colour is picked
+    { PHASE_PICK_CARD, 1, false, LAST_CARD_WINS, RUN_CONTINUE }, // A regular card
+    { PHASE_PICK_CARD, 1, false, LAST_CARD_WINS, RUN_END_LAST } // Drawing a card
+};
+
+const char* tokenNames[NUM_OF_TOKENS] = { "plus", "stop", "dir", "taki", "color", "reg", "draw" }; // The names of the tokens in a rule set file
+
+/*
+    The description of the rules of a game, read from a rule set file and compiled by compileRuleSet into the tables
+    the game uses (turnRules, legalTable, runTable, dealSize and the deck), so a variant costs the same as the built-in rules.
+    legal[card][top] is set when a card of that kind can be placed on a top card of that kind whatever their colours,
+    a card of the same kind as the top card can always be placed. anyRun[card] is set when the card can be placed inside
+    a TAKI run of any colour.
+*/
+
+typedef struct ruleSet {
+    TurnRule turnRules[NUM_OF_TOKENS];
+    bool legal[CARDS_RANGE][CARDS_RANGE];
+    bool anyRun[CARDS_RANGE];
+    int dealSize;
+    bool finiteDeck; // The cards are drawn from a shuffled deck, else every card drawn is made at random
+    int copies[CARDS_RANGE]; // The copies of each kind in a finite deck, of each colour except for the COLOR card
+} RuleSet;
+
+// The compiled rules, written once by compileRuleSet before any game starts and only read afterwards.
+TurnRule turnRules[NUM_OF_TOKENS]; // Indexed by the token - TOKEN_FIRST
+unsigned short legalOn[CARDS_RANGE]; // Indexed by the kind of the top card, bit k is set when a card of kind k can be placed whatever the colours
+unsigned short runKinds; // Bit k is set when a card of kind k can be placed inside a TAKI run of any colour
+unsigned char legalTable[CARDS_RANGE][KIND_CODES]; // legalOn as bytes of 0x00 / 0xFF, looked up by the vector code
+unsigned char runTable[KIND_CODES]; // runKinds as bytes
+int dealSize; // The amount of cards dealt to each player
+int numOfDeckCards; // The size of the finite deck, 0 when the cards are made at random
+Card deckTemplate[DECK_MAX_CARDS]; // The cards of the finite deck in order, copied and shuffled for each game
+
+/*
+    State of a xoshiro256** random number generator, every game owns its own generators so games never share state
+    and a game can be replayed from its seed.
+*/
+
+typedef struct rng {
+    uint64_t s[4];
+} Rng;
+
+/*
+    A frame is the text of one screen update, it is composed in memory and written to the screen with a single write.
+    cardsPerRow is the amount of cards printed side by side, 1 prints every card under the previous one.
+*/
+
+typedef struct frame {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int cardsPerRow;
+} Frame;
+
+/*
+    The live display, the screen is drawn once and then changed in place with ANSI cursor positioning.
+    Every seat has a line with the amount of cards in its hand, only the hand of the current player is shown, in whole rows
+    of cards under the seats, as the players share the screen. The cards shown are kept, so only the slots whose card changed
+    are sent again, and the amount of text written for a turn doesn't depend on the size of the hands.
+    A hand that needs another row moves the questions down, then the whole screen is drawn again.
+*/
+
+typedef struct liveScreen {
+    int* seatSizes; // The size of the hand written on the line of each seat, -1 when the line is not drawn
+    int numOfSeats;
+    Card* shown; // The cards of the hand on the screen, room for rows * cardsPerRow cards
+    int shownSize; // The amount of cards on the screen, -1 when the hand is not drawn
+    int rows;
+    int handLine; // The line of the first row of the hand
+    int cardsPerRow;
+    int turn; // The player named by the banner, -1 when the screen has to be drawn from scratch
+    int topCard; // The top card on the screen, -1 when it is not drawn
+    int promptLine; // The line under the hand, where the questions are asked
+} LiveScreen;
+
+/*
+    The cards of a hand counted by kind and colour, kept next to the deck so a question about the whole hand
+    (is any card legal, how many cards of a colour) costs the same for any size of hand. The deck stays the order
+    the cards are numbered in, for the screen and the choices of validateMove. The COLOR card is counted in colour NO_COLOR.
+    Only a hand longer than MASK_CARDS is counted, a shorter one is answered by legalMask just as fast.
+*/
+
+typedef struct handCounts {
+    unsigned short cell[CARDS_RANGE][COLOR_G + 1]; // Indexed by the kind and the colour
+    unsigned short kind[CARDS_RANGE];
+    unsigned short colour[COLOR_G + 1];
+} HandCounts;
+
+/*
+    An arena holding the hands of every player of a game in one contiguous region.
+    A hand that grows is moved to a new block of the arena (or extended in place when it is the last block),
+    nothing is freed until the arena is reset between games.
+    When a game needs more than the capacity, the extra blocks are taken from the heap (overflow), and on the next reset
+    the region grows to fit them, so after a few games no heap calls are made at all.
+*/
+
+typedef struct arenaBlock {
+    struct arenaBlock* next;
+    Card cards[];
+} ArenaBlock;
+
+typedef struct handArena {
+    Card* base;
+    size_t used;
+    size_t capacity;
+    size_t overflowCards; // The amount of cards taken from the heap since the last reset
+    ArenaBlock* overflow;
+} HandArena;
+
+struct info;
+struct player;
+
+/*
+    Struct representing the decision maker of a player.
+    pickCard returns 0 for drawing a card or 1 - handSize for placing a card, pickColor returns COLOR_Y - COLOR_G.
+    The context is passed back to both functions, so a strategy can keep its own state.
+*/
+typedef struct strategy {
+    int (*pickCard)(struct info* info, struct player* player, void* context);
+    int (*pickColor)(struct info* info, struct player* player, void* context);
+    void* context;
+} Strategy;
 
 /* Struct representing a player
    Contains the name, the deck of the player, the current quantity of cards in the deck and the total capacity of the deck.
+   A player with no strategy is a human, his decisions are read from stdin.
+   The name is kept in the name pool and the deck in the arena of the game, so a seat costs 48 bytes on 64-bit targets.
 */
 typedef struct player {
-    char name[MAX_NAME];
     Card* deck;
-    int handSize;
-    int handCapacity;
+    const char* name; // Interned with internName, players with the same name share it
+    Strategy* strategy;
+    uint64_t handHash; // The sum of the Zobrist keys of the cards in the deck, see zobristKey
+    HandCounts* counts; // The deck counted by kind and colour, NULL unless the hand is longer than MASK_CARDS, see countHand
+    unsigned short handSize;
+    unsigned short handCapacity;
 } Player;
 
+/*
+    The pool of the names of the players, every name is stored once and kept until the program exits.
+    The strings are copied into blocks that never move, so a name can be held as a plain pointer, and an open
+    addressing hash table finds the copy of a name. The pool is shared by every thread, under the lock.
+*/
+
+typedef struct nameBlock {
+    struct nameBlock* next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} NameBlock;
+
+typedef struct namePool {
+    const char** slots; // The hash table, NULL for an empty slot
+    size_t numOfSlots;
+    size_t numOfNames;
+    size_t bytes; // The memory of the pool, the blocks and the table
+    NameBlock* blocks; // The block strings are copied to, followed by the full ones
+    mtx_t lock;
+} NamePool;
+
 /*
     Struct representing the histogram/statistics of the game
-    contatins the type of the card and a counter.
+    contatins a counter for each kind of card, indexed by the kind.
 */
 
 typedef struct histogram {
-    char type[MAX_CARD_NAME];
-    int count;
+    long long count[CARDS_RANGE];
 } Histogram;
 
+/*
+    The count, the mean and the variance of a stream of values, updated in constant memory with Welford's method.
+    Two of them merge into the statistics of both streams, so every thread can keep its own.
+*/
+
+typedef struct runningStat {
+    long long count;
+    double mean;
+    double m2; // The sum of the squared distances from the mean
+    double min;
+    double max;
+} RunningStat;
+
+/*
+    A quantile sketch of a stream of non negative values. The values below SKETCH_EXACT have a bucket each, above it
+    every power of two is split into 2^SKETCH_SUB_BITS buckets. The memory is fixed however many values are pushed,
+    and two sketches merge by adding their buckets.
+*/
+
+typedef struct quantileSketch {
+    long long count;
+    long long buckets[SKETCH_BUCKETS];
+} QuantileSketch;
+
+/*
+    The statistics of the games played by one thread, written to the file of --stats when the run ends.
+    The rules count the game in progress and the totals are updated when it ends, the threads merge their totals.
+    Seat 0 starts every game, so a seat is also the starting position.
+*/
+
+typedef struct gameStats {
+    // The game in progress
+    int moves;
+    int flips; // The times the rotation was reversed
+    int runCards; // The cards placed in the current TAKI run
+
+    long long games;
+    RunningStat moveStat; // Moves per game
+    RunningStat runStat; // Cards per TAKI run
+    RunningStat flipStat; // Rotation flips per game
+    QuantileSketch moveSketch;
+    QuantileSketch runSketch;
+    int numOfSeats;
+    long long* seatWins;
+    long long* seatCardsLeft; // The cards left in the hand of the seat when its games ended
+    long long flipGames[STATS_FLIP_GROUPS]; // Indexed by the flips of the game
+    long long flipStarterWins[STATS_FLIP_GROUPS]; // The games of the group won by seat 0
+    long long flipMoves[STATS_FLIP_GROUPS];
+} GameStats;
+
+/*
+    The moves of the users read from a script file instead of stdin. The file is read with one bulk read and the words
+    are scanned by hand when they are needed, once the script runs out the moves are read from stdin again.
+*/
+
+typedef struct script {
+    char* data;
+    size_t length;
+    size_t position; // The start of the next word
+} Script;
+
+/*
+    The options of an interactive game, given on the command line or in a config file. What is not given is asked for,
+    a seat with a strategy is played by a bot.
+*/
+
+typedef struct gameOptions {
+    int numOfPlayers; // 0 when it is asked for
+    int numOfNames;
+    int numOfStrategies;
+    char names[MAX_PLAYERS_LINEUP][MAX_NAME];
+    char strategyNames[MAX_PLAYERS_LINEUP][MAX_NAME]; // "human" or a name given to newStrategy
+    bool seeded;
+    uint64_t seed;
+    char scriptPath[OPTIONS_MAX_LINE]; // Empty when the moves are read from stdin
+    int cardsPerRow;
+    bool live;
+} GameOptions;
+
+/*
+    The finite deck of a game. The draw pile and the discard pile share one buffer of the size of the deck: the draw pile
+    fills it from the start and is drawn from its end, the discard pile fills it down from the end. Every card of the deck is
+    in one of the piles, in a hand or on top, so the piles never meet. When the draw pile runs out the discard pile
+    is moved to the start of the buffer and shuffled into a new draw pile, without any allocation.
+*/
+
+typedef struct deck {
+    Card* cards; // NULL when the cards are made at random, see drawCard
+    int size;
+    int drawCount;
+    int discardCount;
+} Deck;
+
 /*
     Holding metadata of the game, data that is not relevent for each player (except for the top card).
     Hold the number of players, the player currently playing, the rotation, the top card and a histogram
     that is updated at run-time.
+    When headless is set nothing is printed to the screen, it is used for simulating games between strategies.
 */
 
 typedef struct info {
     int numOfPlayers;
     int currentlyPlaying;
     bool rotation;
+    bool headless;
+    unsigned char phase; // PHASE_*, what the next action of the current player is
+    unsigned char takiColour; // The colour of the current TAKI run, NO_COLOR when no run is in progress
+    token takiToken; // The token of the last card placed in the current TAKI run, applied when the run ends
+    Rng rng; // Deals the cards
+    Rng botRng; // Used by the strategies, a separate stream so the cards dealt don't depend on their decisions
+    Frame* frame; // The frame the screen is composed in, not used when headless
+    LiveScreen* live; // NULL unless the screen is drawn in place, see LiveScreen
+    HandArena arena; // Holds the decks of the players
     Card topCard;
-    Histogram histogram[CARDS_RANGE];
+    uint64_t sizeHash; // The XOR of the keys of the sizes of the hands of the players, see sizeKey
+    Histogram histogram;
+    struct player* players; // The players of the game, set by the game loop for strategies that look at the whole table
+    struct recorder* recorder; // NULL when the game is not recorded
+    struct tracer* tracer; // NULL when the game is not traced
+    GameStats* stats; // NULL when no statistics are collected
+    Script* script; // NULL when the moves of the users are read from stdin
+    const unsigned char* deckKinds; // The kinds a drawn card is chosen from, NULL for every kind with the same chance
+    int numOfDeckKinds;
+    Deck deck;
 } GameInfo;
 
-void setSeed();
-int getRandInRange(int n);
+/*
+    A record file, shared by every recorder of a run, the recorders append whole blocks of games under the lock.
+*/
+
+typedef struct recordFile {
+    FILE* file;
+    mtx_t lock;
+} RecordFile;
+
+/*
+    The binary log of the games played by one thread, one byte for each event (see EVENT_*).
+    A recorder writes the games into data, or when replay is set it reads them from data and compares
+    every event of the replayed game with the next event of the log.
+*/
+
+typedef struct recorder {
+    unsigned char* data;
+    size_t length;
+    size_t capacity;
+    size_t position; // The next event to compare, when replaying
+    bool replay;
+    bool mismatch; // Set when a replayed game didn't match its log
+    RecordFile* file;
+} Recorder;
+
+/*
+    The counters and the timers of the instrumentation, every thread counts into its own copy (instrLocal)
+    and adds it to the total when it ends, so counting never touches shared memory.
+*/
+
+typedef struct instrumentation {
+    long long counts[INSTR_COUNTERS];
+    long long calls[INSTR_TIMERS];
+    uint64_t cycles[INSTR_TIMERS];
+} Instrumentation;
+
+/*
+    An event of a trace, one action of a player. Fixed size, so the ring of a tracer is a plain array.
+*/
+
+typedef struct traceEvent {
+    uint32_t game; // The index of the game in the run
+    uint32_t move; // The index of the action in the game
+    unsigned short handSize; // After the action
+    unsigned char player;
+    unsigned char token; // The token of the card placed, TOKEN_FROM_DEC for drawing a card, NO_TOKEN for picking a colour
+    Card card; // The card placed or drawn, the top card after picking a colour
+} TraceEvent;
+
+/*
+    A tracer, a single-producer ring of events. The game thread pushes the events and a drain thread writes them
+    to the file in batches, so the game never waits for the file.
+    head is only written by the game thread and tail only by the drain thread, they are kept on separate cache lines.
+    When the ring is full the policy either drops the event (counted in dropped) or makes the game wait.
+*/
+
+typedef struct tracer {
+    TraceEvent* ring;
+    FILE* file;
+    thrd_t thread;
+    int policy; // TRACE_DROP or TRACE_BLOCK
+    char padRead[CACHE_LINE];
+
+    // The game thread
+    atomic_size_t head; // The amount of events pushed
+    size_t cachedTail; // The tail last seen by the game thread, read again only when the ring looks full
+    uint32_t games; // The amount of games started
+    uint32_t move;
+    long long dropped;
+    char padHead[CACHE_LINE];
+
+    // The drain thread
+    atomic_size_t tail; // The amount of events written
+    atomic_bool done; // Set by closeTracer, the drain thread writes what is left and exits
+} Tracer;
+
+/*
+    A record file mapped to memory for reading.
+*/
+
+typedef struct recordMap {
+    const unsigned char* data;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} RecordMap;
+
+/*
+    A flat copy of a game position, holding no pointers so it can be copied with memcpy, kept for rollback or written anywhere.
+    The hands are stored one after the other in cards, in the order of the players, each handSize long,
+    followed by the draw pile and the discard pile of a finite deck.
+    Both generators are included, so a restored game draws the same cards it drew the first time.
+*/
+
+typedef struct gameSnapshot {
+    Rng rng;
+    Rng botRng;
+    unsigned short handSize[SNAPSHOT_MAX_PLAYERS];
+    unsigned short numOfCards; // The amount of cards used in cards, only that many are copied
+    unsigned short drawCount; // The finite deck, its piles follow the hands in cards
+    unsigned short discardCount;
+    unsigned char numOfPlayers;
+    unsigned char currentlyPlaying;
+    bool rotation;
+    unsigned char phase;
+    unsigned char takiColour;
+    unsigned char takiToken;
+    Card topCard;
+    Card cards[SNAPSHOT_MAX_CARDS];
+} GameSnapshot;
+
+/*
+    A workload of the benchmark, games of greedy players with a fixed seed.
+    The players of a hoarding workload draw until they hold hoardHand cards before they start placing, for long games with large hands.
+*/
+
+typedef struct benchWorkload {
+    const char* name;
+    int numOfPlayers;
+    int gamesDivisor; // The workload plays the amount of games given to the benchmark divided by this
+    const unsigned char* deckKinds;
+    int numOfDeckKinds;
+    int hoardHand;
+} BenchWorkload;
+
+/*
+    A position kept from a workload, with the choice the player made in it.
+*/
+
+typedef struct benchPosition {
+    GameSnapshot snapshot;
+    int choice;
+} BenchPosition;
+
+/*
+    The context of the strategy of the benchmark, counting the moves and keeping positions while the workload plays.
+    The functions are timed on a batch of games restored from the positions.
+*/
+
+typedef struct benchContext {
+    const BenchWorkload* workload;
+    long long moves;
+    bool sampling;
+    bool full[BENCH_MAX_PLAYERS]; // A hoarding player who reached the hand size, cleared before each game
+    BenchPosition* positions;
+    int numOfPositions;
+    GameInfo batch[BENCH_BATCH];
+    Player batchPlayers[BENCH_BATCH][BENCH_MAX_PLAYERS];
+} BenchContext;
+
+/*
+    A tournament is split into tasks, each task plays a chunk of games of one matchup (a pair of strategies
+    sitting in alternating seats) rotated by a number of seats, so every strategy plays from every seat.
+*/
+
+typedef struct tournamentTask {
+    int matchup;
+    int rotation;
+    int firstGame; // The number of the first game of the task in the tournament, used for seeding the games
+    int numOfGames;
+} TournamentTask;
+
+/*
+    A work stealing queue of task indices (Chase-Lev deque).
+    The owner takes tasks from the bottom, the other workers steal from the top.
+    All the tasks are pushed before the workers start, so the buffer never grows.
+*/
+
+typedef struct workQueue {
+    atomic_long top;
+    atomic_long bottom;
+    long capacity;
+    int* tasks;
+} WorkQueue;
+
+/*
+    The results collected by one worker, merged into the results of the tournament after all the workers are done.
+    seatWins is indexed by the seat of the winner, strategyWins and strategySeats by the index of the strategy.
+    The counters are kept in the struct, so those of a worker are in its own cache lines with the rest of the worker.
+*/
+
+typedef struct tournamentStats {
+    long long games;
+    long long seatWins[MAX_PLAYERS_LINEUP];
+    long long strategyWins[MAX_STRATEGIES];
+    long long strategySeats[MAX_STRATEGIES];
+} TournamentStats;
+
+/*
+    The live results of a tournament worker, for --progress. Only the worker writes its block, a relaxed store of each of
+    its own totals after every game, and the progress thread sums the blocks with atomic loads, so the workers never wait
+    for the reader. The blocks are aligned to whole cache lines, so no two workers write to a line.
+    A snapshot may hold a game in some counters and not yet in others, it is only used for watching the tournament.
+*/
+
+typedef struct liveCounters {
+    _Alignas(CACHE_LINE) atomic_llong games;
+    atomic_llong seatWins[MAX_PLAYERS_LINEUP];
+    atomic_llong strategyWins[MAX_STRATEGIES];
+    atomic_llong strategySeats[MAX_STRATEGIES];
+    atomic_llong draws[CARDS_RANGE]; // The histogram of the worker
+} LiveCounters;
+
+struct tournament;
+
+/*
+    A worker of the tournament, it owns everything needed for playing its games.
+    The workers are aligned to whole cache lines, so the counters of one worker never share a line with its neighbours.
+*/
+
+typedef struct tournamentWorker {
+    _Alignas(CACHE_LINE) struct tournament* tournament;
+    int id;
+    GameInfo info;
+    Player players[MAX_PLAYERS_LINEUP]; // The first numOfPlayers of the tournament are seated
+    Strategy* strategies[MAX_STRATEGIES]; // The worker's own instance of each strategy, a strategy may keep state
+    TournamentStats stats;
+    GameStats gameStats; // Only used with --stats
+    Recorder recorder;
+} TournamentWorker;
+
+typedef struct tournament {
+    int numOfGames;
+    int numOfPlayers;
+    int numOfThreads;
+    int numOfStrategies;
+    char* strategyNames[MAX_STRATEGIES];
+    int numOfMatchups;
+    uint64_t seed; // Game number i of the tournament is played with the seed + i
+    int numOfTasks;
+    TournamentTask* tasks;
+    WorkQueue* queues;
+    TournamentWorker* workers;
+    RecordFile* record; // NULL when the games are not recorded
+    LiveCounters* live; // One block for each worker, NULL without --progress
+    int progressMs; // The interval of the progress thread
+    atomic_bool done; // Set once the workers are joined, the progress thread then exits
+    double start;
+} Tournament;
+
+/*
+    A node of the ISMCTS tree, reached from its parent by taking the action.
+    A single tree holds the decisions of every player: wins counts the playouts won by the player who took the action,
+    and avail counts the playouts in which the action was legal, since the hidden hands differ between playouts.
+*/
+
+typedef struct searchNode {
+    int action;
+    int player;
+    int visits;
+    int avail;
+    int wins;
+    int firstChild;
+    int nextSibling;
+} SearchNode;
+
+/*
+    An entry of the transposition table, the playouts through a position and an action and how many of them the player taking
+    the action won. The entries are written by every search thread without a lock: check holds the key XORed with data,
+    so an entry torn by two threads writing together doesn't match its key and is treated as empty.
+*/
+
+typedef struct tableEntry {
+    _Atomic uint64_t check;
+    _Atomic uint64_t data; // The playouts in the low 32 bits, the wins in the high 32 bits
+} TableEntry;
+
+typedef struct transpositionTable {
+    TableEntry* entries;
+    uint64_t mask; // The amount of entries - 1
+} TranspositionTable;
+
+struct ismctsBot;
+
+/*
+    A search thread of the ISMCTS player, it plays its playouts on its own copy of the game and grows its own tree.
+    The trees of all the threads are merged at the root once the time of the move is up.
+*/
+
+typedef struct searchWorker {
+    struct ismctsBot* bot;
+    GameInfo info;
+    Player* players;
+    Strategy strategy; // Picks the moves of every player of the playouts
+    SearchNode* nodes;
+    int numOfNodes;
+    int current; // The node the playout is at, NO_NODE once the playout left the tree
+    int path[ISMCTS_MAX_DEPTH];
+    uint64_t pathKeys[ISMCTS_MAX_DEPTH]; // The key of the position and action of each node of the path
+    int pathLength;
+    Rng rng;
+    long long playouts;
+    long long tableHits;
+} SearchWorker;
+
+/*
+    The context of the ISMCTS strategy.
+    Every move is searched for budget seconds on numOfThreads threads, the totals are kept for reporting the playouts per second.
+    The threads share the transposition table, it is kept for the whole game since the same position has the same value on every move.
+*/
+
+typedef struct ismctsBot {
+    double budget;
+    int numOfThreads;
+    int numOfPlayers; // The amount of players the workers are allocated for
+    SearchWorker* workers;
+    TranspositionTable table;
+    GameSnapshot root; // The position being searched, only read while the workers run
+    int rootPlayer;
+    double deadline;
+    long long moves;
+    long long playouts;
+    long long tableHits;
+    double seconds;
+    Rng rng;
+} IsmctsBot;
+
+/*
+    Games of bots advanced in lockstep, every active game takes one action in each round. Each game is played in a lane,
+    the state of the games is kept in parallel arrays indexed by the lane, so the parts of a round that are the same for
+    every game (applying the turn rules, turning the seat and drawing cards) are loops over the lanes without branches that the
+    compiler turns into vector code. The decisions are made lane by lane, each strategy looks at its own hand.
+    The hands are indexed by the player and then the lane. A lane whose game is over takes the next game of the queue,
+    game number i is played with the seed + i, the same game playHeadlessGame plays with that seed.
+*/
+
+typedef struct batch {
+    int numOfLanes; // A whole amount of groups, the lanes past the amount asked for are never active
+    int numOfPlayers;
+    Strategy* strategy; // Must only look at the hand of the player and the top card, i.e random or greedy
+    const unsigned char* deckKinds; // As in GameInfo
+    int numOfDeckKinds;
+    uint64_t seed;
+    long long numOfGames;
+    long long nextGame; // The next game of the queue
+    long long* wins; // Indexed by the seat of the winner
+    Histogram histogram;
+    GameInfo view; // The lane the strategy is deciding in, holding only what the strategy looks at
+    Player viewPlayer;
+    unsigned char active[BATCH_MAX_LANES]; // The lane is playing a game
+    Card topCard[BATCH_MAX_LANES];
+    signed char direction[BATCH_MAX_LANES]; // 1 for clockwise, -1 for counter clockwise
+    unsigned char currentlyPlaying[BATCH_MAX_LANES];
+    unsigned char phase[BATCH_MAX_LANES];
+    unsigned char takiColour[BATCH_MAX_LANES];
+    unsigned char takiToken[BATCH_MAX_LANES];
+    unsigned char mover[BATCH_MAX_LANES]; // The player who took the action of the round
+    // The turn rule the action of the round ends the turn with, the columns of turnRules copied for each lane
+    unsigned char apply[BATCH_MAX_LANES]; // 0 when the turn goes on
+    unsigned char empty[BATCH_MAX_LANES]; // The hand of the mover is empty
+    unsigned char advance[BATCH_MAX_LANES];
+    unsigned char reverse[BATCH_MAX_LANES];
+    unsigned char nextPhase[BATCH_MAX_LANES];
+    unsigned char lastCard[BATCH_MAX_LANES];
+    unsigned char needDraw[BATCH_MAX_LANES]; // The mover draws a card in this round
+    uint64_t rng[4][BATCH_MAX_LANES]; // The state of the generator of each lane, one array for each word of the state
+    uint64_t botRng[4][BATCH_MAX_LANES];
+    unsigned short handSize[BATCH_MAX_PLAYERS][BATCH_MAX_LANES];
+    unsigned short handCapacity[BATCH_MAX_PLAYERS][BATCH_MAX_LANES];
+    Card* hands[BATCH_MAX_PLAYERS][BATCH_MAX_LANES];
+} Batch;
+
+uint64_t splitMix64(uint64_t* state);
+void seedRng(Rng* rng, uint64_t seed);
+uint64_t nextRand(Rng* rng);
+void jumpRng(Rng* rng);
+void seedGame(GameInfo* info, uint64_t seed);
+int getRandInRange(Rng* rng, int n);
 void welcomeMsg();
 void enterNameMsg(int playerId);
-void setPlayerName(char* name, int playerId);
+void setPlayerName(GameInfo* info, char* name, int playerId);
+void initNamePool();
+uint64_t hashName(const char* name);
+const char* internName(const char* name);
 void enterNumOfPlayersMsg();
-void setNumOfPlayers(int* numOfPlayers);
-void initPlayers(Player* players, int numOfPlayers);
-void setNewCard(Card* newCard, char* type, char colour);
-void makePlayerCard(Card* card, int choice);
-void initTopCard(Card* topCard, int choice);
-void displayCards(Card* card);
-void showPlayerHand(Card* deck, int handSize);
-errorCode validateMove(Card* topCard, Player* player, int choice);
-token mapTopType(char* topType);
+void setNumOfPlayers(GameInfo* info, int* numOfPlayers);
+void initPlayers(GameInfo* info, Player* players, int numOfPlayers, GameOptions* options);
+void dealHand(GameInfo* info, Player* player);
+void makePlayerCard(Rng* rng, Card* card, int choice);
+bool drawCard(GameInfo* info, Card* card);
+void dealTopCard(GameInfo* info);
+void initTopCard(Rng* rng, Card* topCard, int choice);
+void buildGlyph(Card card, char glyph[LENGTH_CARD][WIDTH_CARD]);
+void initGlyphCache();
+void initFrame(Frame* frame, int cardsPerRow);
+void frameAppend(Frame* frame, const char* data, size_t length);
+void frameAppendStr(Frame* frame, const char* str);
+void frameAppendInt(Frame* frame, int num);
+void flushFrame(Frame* frame);
+void freeFrame(Frame* frame);
+void displayCards(Frame* frame, Card* card);
+void showPlayerHand(Frame* frame, Card* deck, int handSize);
+void initLiveScreen(LiveScreen* live, int numOfPlayers, int cardsPerRow);
+void freeLiveScreen(LiveScreen* live);
+void frameAppendMove(Frame* frame, int line, int column);
+void layoutLiveScreen(LiveScreen* live);
+void drawLiveSlot(Frame* frame, LiveScreen* live, int slot, Card* card);
+void updateLiveScreen(GameInfo* info, Player* player);
+errorCode validateMove(GameInfo* info, Player* player, int choice);
+token mapTopType(Card card);
 void swapCards(Card* c1, Card* c2);
-token makeAMove(GameInfo* info, Player* player);
-void setNewTopColor(Card* topCard);
+int readCardChoice(GameInfo* info, Player* player);
+int readColorChoice(GameInfo* info, Player* player);
+int readAction(GameInfo* info, Player* player);
+bool drawToHand(GameInfo* info, Player* player);
+token placeCard(GameInfo* info, Player* player, int choice);
+void setNewTopColor(GameInfo* info, int choice);
 void updateScreen(GameInfo* info, Player* player);
-void changeGameState(GameInfo* info, Player* player, token tokenType, bool* isWinner);
+void applyTurnRule(GameInfo* info, Player* player, token tokenType);
+void endTakiRun(GameInfo* info, Player* player, token tokenType);
+errorCode step(GameInfo* info, int action);
 void rotationHandler(GameInfo* info);
-errorCode validateMoveOnTaki(GameInfo* info, char takiColour);
-void takiHandler(GameInfo* info, Player* player, bool* isWinner);
-void checkIfWinner(Player* player, bool* isGameOver);
-void gameLoop(GameInfo* info, Player* players);
+int gameLoop(GameInfo* info, Player* players);
 void checkCardAlloc(Card* newDeck);
 void checkPlayerAlloc(Player* player);
 void copyDeck(Card* dest, Card* source, int copySize);
-Card* deckRealloc(Player* player, int newSize);
-void initHistogram(GameInfo* info);
-int returnCardIndex(Card* card);
+Card* deckRealloc(GameInfo* info, Player* player, int newSize);
+void initArena(HandArena* arena, size_t capacity);
+Card* arenaAlloc(HandArena* arena, size_t count);
+bool arenaExtend(HandArena* arena, Card* block, size_t oldCount, size_t newCount);
+void resetArena(HandArena* arena);
+void freeArena(HandArena* arena);
+void shuffleCards(Rng* rng, Card* cards, int count);
+void shuffleDeck(GameInfo* info);
+bool drawFromDeck(GameInfo* info, Card* card);
+void discardCard(GameInfo* info, Card card);
+void freeDeck(Deck* deck);
+errorCode snapshotGame(GameInfo* info, Player* players, GameSnapshot* snapshot);
+void restoreGame(GameInfo* info, Player* players, GameSnapshot* snapshot);
+uint64_t zobristKey(uint64_t index);
+uint64_t hashHand(Player* player);
+uint64_t sizeKey(int seat, int handSize);
+void hashSizes(GameInfo* info, Player* players);
+uint64_t gameHash(GameInfo* info);
+void initHistogram(Histogram* histogram);
 void incHistogram(GameInfo* info, Card* drawnCard);
+void mergeHistogram(Histogram* dest, Histogram* source);
 void initGameInfo(GameInfo* info);
-void merge(Histogram* arr1, int size1, Histogram* arr2, int size2, Histogram* temp);
-void copyDataFromTemp(Histogram* dest, Histogram* source, int size);
-void mergeSort(Histogram* data, int size);
-void sortHistogram(GameInfo* info);
-void printHistogram(GameInfo* info);
+void sortHistogram(Histogram* histogram, unsigned char rank[CARDS_RANGE]);
+void printHistogram(Histogram* histogram);
 void exitGame(GameInfo* info, Player* players);
+void defaultRuleSet(RuleSet* rules);
+errorCode loadScript(Script* script, const char* path);
+bool nextScriptWord(Script* script, const char** word, size_t* length);
+int readNumber(GameInfo* info);
+void readWord(GameInfo* info, char* word, int size);
+void initGameOptions(GameOptions* options);
+int splitList(char* list, char dest[][MAX_NAME]);
+errorCode setGameOption(GameOptions* options, const char* key, char* value);
+errorCode loadGameOptions(GameOptions* options, const char* path);
+errorCode parseGameOptions(GameOptions* options, int argc, char* argv[]);
+errorCode runInteractiveGame(GameOptions* options, RecordFile* recordTo, Tracer* traceTo);
+int findName(const char* names[], int count, const char* name);
+errorCode parseRuleLine(RuleSet* rules, char* line);
+errorCode loadRuleSet(RuleSet* rules, char* path);
+void compileRuleSet(RuleSet* rules);
+bool isLegalCard(GameInfo* info, Card card);
+uint64_t legalMaskScalar(GameInfo* info, Card* cards, int count);
+uint64_t legalMask(GameInfo* info, Card* cards, int count);
+int countBits(uint64_t mask);
+int lowestBit(uint64_t mask);
+int highestBit(uint64_t mask);
+void countHands(GameInfo* info, Player* players);
+void countHand(HandArena* arena, Player* player);
+void addToCounts(HandCounts* counts, Card card);
+void removeFromCounts(HandCounts* counts, Card card);
+int countLegalCards(GameInfo* info, HandCounts* counts);
+int randomPickCard(GameInfo* info, Player* player, void* context);
+int randomPickColor(GameInfo* info, Player* player, void* context);
+int greedyPickCard(GameInfo* info, Player* player, void* context);
+int greedyPickColor(GameInfo* info, Player* player, void* context);
+Strategy* newStrategy(char* name, int searchThreads, uint64_t seed);
+void freeStrategy(Strategy* strategy);
+void printStrategyReport(char* name, Strategy** instances, int numOfInstances);
+void initBotPlayers(Player* players, int numOfPlayers, Strategy* strategy);
+int playHeadlessGame(GameInfo* info, Player* players, uint64_t seed);
+errorCode runSimulation(int numOfGames, int numOfPlayers, char* strategyName, uint64_t seed, RecordFile* record, Tracer* tracer, const char* statsPath);
+errorCode runLargeTable(int numOfSeats, int numOfGames, char* strategyName, uint64_t seed, const char* statsPath);
+Batch* newBatch(int numOfLanes, int numOfPlayers, Strategy* strategy, long long numOfGames, uint64_t seed);
+void freeBatch(Batch* batch);
+void loadLaneRng(uint64_t state[4][BATCH_MAX_LANES], int lane, Rng* rng);
+void storeLaneRng(uint64_t state[4][BATCH_MAX_LANES], int lane, Rng* rng);
+void refillLane(Batch* batch, int lane);
+void decideLane(Batch* batch, int lane);
+void applyBatchRules(Batch* batch);
+void nextBatchRands(Batch* batch, unsigned char need[], uint64_t rands[]);
+void drawBatchRand(Batch* batch, unsigned char need[], uint32_t n, uint32_t values[]);
+void drawBatchCards(Batch* batch);
+bool playBatchRound(Batch* batch);
+errorCode runBatch(int numOfGames, int numOfPlayers, char* strategyName, uint64_t seed, int numOfLanes);
+void pushRunningStat(RunningStat* stat, double value);
+void mergeRunningStat(RunningStat* dest, RunningStat* source);
+double runningStdDev(RunningStat* stat);
+int sketchBucket(uint64_t value);
+double sketchValue(int bucket);
+void pushSketch(QuantileSketch* sketch, uint64_t value);
+void mergeSketch(QuantileSketch* dest, QuantileSketch* source);
+double sketchQuantile(QuantileSketch* sketch, double quantile);
+void initGameStats(GameStats* stats, int numOfSeats);
+void freeGameStats(GameStats* stats);
+void endStatsRun(GameStats* stats);
+void endStatsGame(GameStats* stats, Player* players, int winner);
+void mergeGameStats(GameStats* dest, GameStats* source);
+void writeDistributionJson(FILE* file, const char* name, RunningStat* stat, QuantileSketch* sketch);
+void writeDistributionCsv(FILE* file, const char* name, RunningStat* stat, QuantileSketch* sketch);
+void writeGameStats(GameStats* stats, const char* path);
+int getCoreCount();
+double wallSeconds();
+void* allocCacheLines(size_t size);
+void freeCacheLines(void* block);
+void initWorkQueue(WorkQueue* queue, long capacity);
+void pushTask(WorkQueue* queue, int task);
+int takeTask(WorkQueue* queue);
+int stealTask(WorkQueue* queue);
+void getMatchup(Tournament* tournament, int matchup, int* first, int* second);
+int seatStrategy(Tournament* tournament, TournamentTask* task, int seat);
+void buildTournamentTasks(Tournament* tournament);
+int nextTournamentTask(TournamentWorker* worker);
+void playTournamentTask(TournamentWorker* worker, TournamentTask* task);
+int tournamentWorkerMain(void* arg);
+void mergeTournamentStats(TournamentStats* dest, TournamentStats* source, int numOfPlayers);
+void printTournamentResults(Tournament* tournament, TournamentStats* total, Histogram* histogram, double seconds);
+void initLiveCounters(LiveCounters* live);
+void publishLiveCounters(TournamentWorker* worker);
+void sumLiveCounters(Tournament* tournament, TournamentStats* total, Histogram* histogram);
+void printProgress(Tournament* tournament, TournamentStats* total, Histogram* histogram);
+int progressMain(void* arg);
+errorCode runTournament(int numOfGames, int numOfPlayers, char* strategyList, int numOfThreads, uint64_t seed, RecordFile* record, const char* statsPath, int progressMs);
+errorCode openRecordFile(RecordFile* record, char* path);
+void closeRecordFile(RecordFile* record);
+void initRecorder(Recorder* recorder, RecordFile* record);
+void recordEvent(GameInfo* info, unsigned char event);
+void recordGameStart(GameInfo* info, Player* players, uint64_t seed);
+void flushRecorder(Recorder* recorder);
+void freeRecorder(Recorder* recorder);
+errorCode mapRecordFile(RecordMap* map, char* path);
+void unmapRecordFile(RecordMap* map);
+uint64_t readSeed(const unsigned char* bytes);
+size_t skipGame(RecordMap* map, size_t position);
+void scanRecords(RecordMap* map);
+int replayPickCard(GameInfo* info, Player* player, void* context);
+int replayPickColor(GameInfo* info, Player* player, void* context);
+void rerunRecords(RecordMap* map);
+errorCode runReplay(char* path, char* mode);
+errorCode openTracer(Tracer* tracer, char* path, int policy);
+void traceGameStart(GameInfo* info);
+void traceAction(GameInfo* info, Player* player, token tokenType, Card card);
+size_t formatTraceEvent(char* text, TraceEvent* event);
+int traceDrainMain(void* arg);
+void closeTracer(Tracer* tracer);
+#if defined(TAKI_INSTRUMENT)
+extern _Thread_local Instrumentation instrLocal;
+uint64_t instrNanoseconds();
+void initInstrLock();
+void mergeInstrumentation();
+void dumpInstrumentation(const char* path);
+#endif
+IsmctsBot* newIsmctsBot(double budget, int numOfThreads, uint64_t seed);
+void freeIsmctsBot(IsmctsBot* bot);
+void prepareSearchWorkers(IsmctsBot* bot, int numOfPlayers);
+void initTranspositionTable(TranspositionTable* table, int bits);
+void freeTranspositionTable(TranspositionTable* table);
+bool probeTable(TranspositionTable* table, uint64_t key, uint32_t* playouts, uint32_t* wins);
+void updateTable(TranspositionTable* table, uint64_t key, bool won);
+int addSearchNode(SearchWorker* worker, int parent, int action, int player);
+int collectActions(GameInfo* info, Player* player, int actions[], int choices[]);
+int selectAction(SearchWorker* worker, int player, int actions[], int numOfActions);
+int searchPickCard(GameInfo* info, Player* player, void* context);
+int searchPickColor(GameInfo* info, Player* player, void* context);
+void determinize(SearchWorker* worker);
+int searchWorkerMain(void* arg);
+int ismctsSearch(IsmctsBot* bot, GameInfo* info, Player* player);
+int ismctsPickCard(GameInfo* info, Player* player, void* context);
+int ismctsPickColor(GameInfo* info, Player* player, void* context);
+uint64_t nowNanos();
+int compareDoubles(const void* a, const void* b);
+double timerOverhead();
+int benchPickCard(GameInfo* info, Player* player, void* context);
+int benchPickColor(GameInfo* info, Player* player, void* context);
+void printBenchFunction(const char* name, double* samples, int numOfSamples, bool last);
+void restoreBenchBatch(BenchContext* bench, int first);
+void timeBenchFunctions(BenchContext* bench, Frame* frame, double overhead);
+void runBenchmark(int numOfGames, uint64_t seed);
+errorCode checkLegalMask(GameInfo* info, Card* cards, int count);
+errorCode runSelfTest(int numOfHands, uint64_t seed);
+
+
+uint64_t splitMix64(uint64_t* state)
+{
+    // SplitMix64, used for expanding a 64-bit seed into the state of the generator.
+    // uint64_t* state - The state of SplitMix64, advanced on each call.
+
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void seedRng(Rng* rng, uint64_t seed)
+{
+    // Seeding the generator, the same seed always gives the same numbers.
+
+    int i;
+
+    for (i = 0; i < 4; i++)
+        rng->s[i] = splitMix64(&seed);
+}
+
+uint64_t nextRand(Rng* rng)
+{
+    // Return value - The next 64 random bits of xoshiro256**.
+
+    uint64_t* s = rng->s;
+    uint64_t result = s[1] * 5;
+    uint64_t t = s[1] << 17;
+
+    result = ((result << 7) | (result >> 57)) * 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
 
+    return result;
+}
+
+void jumpRng(Rng* rng)
+{
+    // Advancing the generator by 2^128 numbers, used for giving each thread its own stream out of one seed.
+
+    static const uint64_t jump[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+    uint64_t s[4] = { 0 };
+    int i, b, j;
+
+    for (i = 0; i < 4; i++) {
+        for (b = 0; b < 64; b++) {
+            if (jump[i] & ((uint64_t)1 << b)) {
+                for (j = 0; j < 4; j++)
+                    s[j] ^= rng->s[j];
+            }
+            nextRand(rng);
+        }
+    }
+    for (j = 0; j < 4; j++)
+        rng->s[j] = s[j];
+}
 
-void setSeed()
+void seedGame(GameInfo* info, uint64_t seed)
 {
-    // Sets the seed.
+    // Seeding the generators of a game, the whole game can be replayed from the seed.
+    // Both generators are expanded from the same SplitMix64 sequence, jumping for every game would cost more than the game itself.
+    // GameInfo* info - Pointer to the info of the game.
+    // uint64_t seed - The seed of the game.
+
+    int i;
 
-    srand(time(NULL));
+    for (i = 0; i < 4; i++)
+        info->rng.s[i] = splitMix64(&seed);
+    for (i = 0; i < 4; i++)
+        info->botRng.s[i] = splitMix64(&seed);
 }
 
-int getRandInRange(int n)
+int getRandInRange(Rng* rng, int n)
 {
+    // Unbiased bounded generation (Lemire's multiply and reject), instead of the biased rand() % n.
     // Return value - A random number in the range 1 - n
 
-    return (rand() % n) + 1;
+    uint64_t m = (nextRand(rng) >> 32) * (uint32_t)n;
+    uint32_t threshold;
+
+    if ((uint32_t)m < (uint32_t)n) {
+        threshold = (uint32_t)(-(uint32_t)n) % (uint32_t)n;
+        while ((uint32_t)m < threshold)
+            m = (nextRand(rng) >> 32) * (uint32_t)n;
+    }
+    return (int)(m >> 32) + 1;
 }
 
 void welcomeMsg()
@@ -192,14 +1284,15 @@ void enterNameMsg(int playerId)
     printf("Please enter the first name of player #%d:\n", playerId);
 }
 
-void setPlayerName(char* name, int playerId)
+void setPlayerName(GameInfo* info, char* name, int playerId)
 {
     // Sets the name of the current player.
+    // GameInfo* info - Pointer to the game info, the name is read from its script when it has one.
     // char *name - The name member of the Player struct.
     // int playerId - - The current player identifier, the first player is #1 etc.
 
     enterNameMsg(playerId);
-    scanf("%s", name);
+    readWord(info, name, MAX_NAME);
 }
 
 void enterNumOfPlayersMsg()
@@ -209,122 +1302,126 @@ void enterNumOfPlayersMsg()
     printf("Please enter the number of players:\n");
 }
 
-void setNumOfPlayers(int* numOfPlayers)
+void setNumOfPlayers(GameInfo* info, int* numOfPlayers)
 {
     // Receives the numOfPlayers member of the GameInfo struct and sets it to the value chosen by the user.
 
     enterNumOfPlayersMsg();
-    scanf("%d", numOfPlayers);
+    *numOfPlayers = readNumber(info);
 }
 
-void initPlayers(Player* players, int numOfPlayers)
+void initPlayers(GameInfo* info, Player* players, int numOfPlayers, GameOptions* options)
 {
     // Function for initalizing each player.
+    // GameInfo* info - Pointer to the game info, its arena holds the decks and its generator deals the cards.
     // Player* players - An array of players, the array contains a pointer to each player.
     // int numOfPlayers - The amount of players that needs to be initialized.
+    // GameOptions* options - The names and the strategies given for the seats, the names of the other humans are asked for.
+    //                        The strategies are checked by parseGameOptions, and seeded from the seed of the options.
 
-    int i, j;
+    char name[MAX_NAME];
+    int i;
 
     for (i = 0; i < numOfPlayers; i++) {
-        setPlayerName(players[i].name, i + 1);
-        players[i].handSize = 0;
-
-        players[i].deck = (Card*)malloc(sizeof(Card) * INIT_QUAN);
-        checkCardAlloc(players[i].deck);
+        players[i].strategy = NULL;
+        players[i].counts = NULL;
+        if (i < options->numOfStrategies && strcmp(options->strategyNames[i], "human") != 0)
+            players[i].strategy = newStrategy(options->strategyNames[i], getCoreCount(), options->seed + i);
+
+        if (i < options->numOfNames)
+            strcpy(name, options->names[i]);
+        else if (players[i].strategy != NULL)
+            sprintf(name, "%s #%d", BOT_NAME, i + 1);
+        else
+            setPlayerName(info, name, i + 1);
+        players[i].name = internName(name);
 
-        for (j = 0; j < INIT_QUAN; j++) {
-            makePlayerCard(&players[i].deck[j], getRandInRange(CARDS_RANGE));
-        }
-        players[i].handSize = INIT_QUAN;
-        players[i].handCapacity = INIT_QUAN;
+        dealHand(info, &players[i]);
     }
 }
 
-void setNewCard(Card* newCard, char* type, char colour)
+void dealHand(GameInfo* info, Player* player)
 {
-    // Setting the data of type and colour for a new card.
+    // Allocating a deck for the player from the arena of the game and dealing the initial cards.
+    // GameInfo* info - Pointer to the game info.
+    // Player* player - Pointer to the player.
+
+    int i;
 
-    newCard->colour = colour;
-    strcpy(newCard->type, type);
+    player->deck = arenaAlloc(&info->arena, dealSize);
+    player->handCapacity = dealSize;
+
+    // A finite deck too small for every hand deals what it has.
+    for (i = 0; i < dealSize && drawCard(info, &player->deck[i]); i++)
+        ;
+    player->handSize = i;
+    player->handHash = hashHand(player);
 }
 
-void makePlayerCard(Card* card, int choice)
+void makePlayerCard(Rng* rng, Card* card, int choice)
 {
     // Function for making a card, makes one card at a time.
+    // Rng* rng - The generator choosing the color.
     // Card* card - Pointer to a card from the players deck.
     // int choice - A randomly generadted value from 1 - max(CARD_RANGE)
 
-    char* validColors = "RGBY";
-    int sizeCol = (int)strlen(validColors);
-    int randCol = getRandInRange(sizeCol - 1); // Generating a number for choosing a random color.
-    char chosenType[MAX_CARD_NAME] = { 0 };
-    char choiceChar = (char)(choice + ZERO_CHAR);
-
-    // If the choice is between 1 and 9 then we need to create a regular card
-    // if not we need a case for each "special" card.
-    switch (choice) {
-    case 1:
-    case 2:
-    case 3:
-    case 4:
-    case 5:
-    case 6:
-    case 7:
-    case 8:
-    case 9:
-        chosenType[0] = choiceChar;
-        chosenType[1] = NULL_CHAR;
-        setNewCard(card, chosenType, validColors[randCol]);
-        break;
-    case TOKEN_PLUS:
-        strcpy(chosenType, STR_PLUS);
-        setNewCard(card, chosenType, validColors[randCol]);
-        break;
-    case TOKEN_CHANGE_COL:
-        strcpy(chosenType, STR_CHANGE_COL);
-        setNewCard(card, chosenType, NO_COLOR);
-        break;
-    case TOKEN_CHANGE_DIR:
-        strcpy(chosenType, STR_CHANGE_DIR);
-        setNewCard(card, chosenType, validColors[randCol]);
-        break;
-    case TOKEN_STOP:
-        strcpy(chosenType, STR_STOP);
-        setNewCard(card, chosenType, validColors[randCol]);
-        break;
-    case TOKEN_TAKI:
-        strcpy(chosenType, STR_TAKI);
-        setNewCard(card, chosenType, validColors[randCol]);
-        break;
-    default:
-        break;
-    }
+    int kind = choice - 1;
+
+    // Every kind has a color, except for the COLOR card.
+    if (kindFlags[kind] & KIND_FLAG_WILD)
+        *card = MAKE_CARD(kind, NO_COLOR);
+    else
+        *card = MAKE_CARD(kind, getRandInRange(rng, COLOR_G)); // COLOR_Y - COLOR_G
+}
+
+bool drawCard(GameInfo* info, Card* card)
+{
+    // Drawing a card from the deck of the game, every card of the game is made here.
+    // With a finite deck the card is taken from the draw pile, else it is made at random.
+    // GameInfo* info - Pointer to the info of the game, its generator and the kinds of its deck.
+    // Card* card - Pointer to the card that is made.
+    // Return value - false if both piles of the finite deck are empty, the card is then left as it is.
+
+    if (info->deck.cards != NULL)
+        return drawFromDeck(info, card);
+    if (info->deckKinds == NULL)
+        makePlayerCard(&info->rng, card, getRandInRange(&info->rng, CARDS_RANGE));
+    else
+        makePlayerCard(&info->rng, card, info->deckKinds[getRandInRange(&info->rng, info->numOfDeckKinds) - 1] + 1);
+    return true;
 }
 
-void initTopCard(Card* topCard, int choice)
+void initTopCard(Rng* rng, Card* topCard, int choice)
 {
     // Initializing the top card acording to the instructions given in the PDF file.
+    // Rng* rng - The generator choosing the color.
     // Card* topCard - A pointer to the top card.
     // int choice - A random number between 1 - 9
 
-    char* validColors = "RGBY";
-    int sizeCol = (int)strlen(validColors);
-    int randCol = getRandInRange(sizeCol - 1);
-    char chosenType[MAX_COLOR_LEN] = { 0 };
-    char choiceChar = (char)(choice + ZERO_CHAR);
+    *topCard = MAKE_CARD(KIND_1 + choice - 1, getRandInRange(rng, COLOR_G));
+}
+
+void dealTopCard(GameInfo* info)
+{
+    // Starting the pile with a number card made at random, the top card of a finite deck was already taken by shuffleDeck.
+    // GameInfo* info - Pointer to the info of the game, its top card is set.
 
-    chosenType[0] = choiceChar;
-    chosenType[1] = NULL_CHAR;
-    setNewCard(topCard, chosenType, validColors[randCol]);
+    if (info->deck.cards != NULL)
+        return;
+    initTopCard(&info->rng, &info->topCard, getRandInRange(&info->rng, 9));
 }
 
-void displayCards(Card* card)
+char glyphCache[CARD_CODES][LENGTH_CARD][WIDTH_CARD]; // The picture of every card, indexed by the packed card
+
+void buildGlyph(Card card, char glyph[LENGTH_CARD][WIDTH_CARD])
 {
-    // Function for printing a card
-    // Card* card - A pointer to the card that need to be printed
+    // Drawing the picture of a card, a frame of '*' with the type in the third row and the color in the fourth.
+    // Card card - The card.
+    // char glyph - The picture, without the new lines.
 
     int i, j;
-    int lengthType = (int)strlen(card->type); // The length of the type of the card, used for calculating an offset used later in the printing
+    const char* type = cardTypeStr[CARD_KIND(card)];
+    int lengthType = (int)strlen(type); // The length of the type of the card, used for calculating an offset used later in the printing
     int offset1, offset2 = 1;
 
     if (lengthType > 1 && lengthType <= 4)
@@ -335,180 +1432,328 @@ void displayCards(Card* card)
         offset1 = 1;
 
     for (i = 0; i < LENGTH_CARD; i++) {
-        if (i == 0 || (i + 1) == LENGTH_CARD) {
-            for (j = 0; j < WIDTH_CARD; j++)
-                printf("*");
-        }
-        else {
-            for (j = 0; j < WIDTH_CARD; j++) {
-                if (j == 0 || (j + 1) == WIDTH_CARD) {
-                    printf("*");
-                }
-                else {
-                    printf(" ");
-                }
-                if (i == 2 && j == (WIDTH_CARD / 2) - offset1) {
-                    printf("%s", card->type);
-                    j += lengthType;
-                }
-                if (i == 3 && j == (WIDTH_CARD / 2) - offset2) {
-                    if (card->colour == NULL_CHAR)
-                        printf(" ");
-                    else
-                        printf("%c", card->colour);
-                    j++;
-                }
-            }
+        for (j = 0; j < WIDTH_CARD; j++) {
+            if (i == 0 || (i + 1) == LENGTH_CARD || j == 0 || (j + 1) == WIDTH_CARD)
+                glyph[i][j] = '*';
+            else
+                glyph[i][j] = ' ';
         }
-        printf("\n");
     }
-    printf("\n");
+
+    // The type and the color start one column after the offset.
+    memcpy(&glyph[2][(WIDTH_CARD / 2) - offset1 + 1], type, lengthType);
+    glyph[3][(WIDTH_CARD / 2) - offset2 + 1] = colourChar[CARD_COLOR(card)];
 }
 
-void showPlayerHand(Card* deck, int handSize)
+void initGlyphCache()
 {
-    // Displaying the players hand
-    // Card* deck - A pointer to the players deck.
-    // int handSize - The physical size of the players deck.
+    // Drawing every (kind, color) pair once, printing a card is then only a copy from the cache.
 
-    int i;
+    int kind, colour;
 
-    for (i = 0; i < handSize; i++) {
-        printf("Card #%d:\n", i + 1);
-        displayCards(&deck[i]);
+    for (kind = 0; kind < CARDS_RANGE; kind++) {
+        for (colour = NO_COLOR; colour <= COLOR_G; colour++)
+            buildGlyph(MAKE_CARD(kind, colour), glyphCache[MAKE_CARD(kind, colour)]);
     }
 }
 
-errorCode validateMove(Card* topCard, Player* player, int choice)
+void initFrame(Frame* frame, int cardsPerRow)
 {
-    // Validating that the players move is indeed a valid one
-    // Card* topCard - A pointer to the top card
-    // Player* player - A pointer to the current player
-    // int choice - The users choice of a card to place on top of the top card
-    // Return value - If the users choice is a valid one a ERROR_OK is returned, if not then a ERROR_INVALID
+    // Initializing an empty frame.
+    // Frame* frame - Pointer to the frame.
+    // int cardsPerRow - The amount of cards printed side by side.
 
-    if (choice > player->handSize)
-        return ERROR_INVALID;
-    else if (choice == 0)
-        return ERROR_OK;
-    else if (*player->deck[choice - 1].type == *topCard->type)
-        return ERROR_OK;
-    else if (player->deck[choice - 1].colour == topCard->colour)
-        return ERROR_OK;
-    else if (mapTopType(player->deck[choice - 1].type) == TOKEN_CHANGE_COL)
-        return ERROR_OK;
-    else if (topCard->colour != player->deck[choice - 1].colour)
-        return ERROR_INVALID;
-    else if (choice < 0 || choice > player->handSize)
-        return ERROR_INVALID;
+    frame->data = (char*)malloc(FRAME_INIT_CAPACITY);
+    if (frame->data == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    frame->length = 0;
+    frame->capacity = FRAME_INIT_CAPACITY;
+    frame->cardsPerRow = cardsPerRow > 0 ? cardsPerRow : 1;
 }
 
-token mapTopType(char* topType)
+void frameAppend(Frame* frame, const char* data, size_t length)
 {
-    // Mapping the type of the top card to the correct token
-    // char* topType - A pointer to the char* representing the top card
-    // Return value - A token representing the type
+    // Appending text to the frame, the buffer is doubled when it is full.
 
-    switch (topType[0]) {
-    case '+':
-        return TOKEN_PLUS;
-    case 'S':
-        return TOKEN_STOP;
-    case '<':
-        return TOKEN_CHANGE_DIR;
-    case 'C':
-        return TOKEN_CHANGE_COL;
-    case 'T':
-        return TOKEN_TAKI;
+    char* newData;
+
+    if (frame->length + length > frame->capacity) {
+        while (frame->length + length > frame->capacity)
+            frame->capacity *= 2;
+        newData = (char*)realloc(frame->data, frame->capacity);
+        if (newData == NULL) {
+            printf("Error: Could not allocate memory !\n");
+            exit(1);
+        }
+        frame->data = newData;
     }
+    memcpy(frame->data + frame->length, data, length);
+    frame->length += length;
 }
 
-void swapCards(Card* c1, Card* c2)
+void frameAppendStr(Frame* frame, const char* str)
 {
-    // Function for swapping cards
-
-    Card temp = *c1;
-    *c1 = *c2;
-    *c2 = temp;
+    frameAppend(frame, str, strlen(str));
 }
 
-token makeAMove(GameInfo* info, Player* player)
+void frameAppendInt(Frame* frame, int num)
 {
-    // One of the main function of the program, receives used input, validates it, and dispatch a call to other function based on the choice.
-    // GameInfo* info - A pointer to the GameInfo, it controls the flow of the game.
-    // Player* player - A pointer to the current player.
-    // Return value - A token identifing the players 'move'
+    // Appending a non negative number to the frame.
 
-    int choice, fromDeck = 0;
-    token tokenType = TOKEN_REG;
+    char digits[12];
+    int i = sizeof(digits);
 
-    printf("Please enter 0 if you want to take a card from the deck\nor 1 - %d"
-        " if you want to put one of your cards in the middle:\n", player->handSize);
-    scanf(" %d", &choice);
-
-    // Validating the users choice
-    while (validateMove(&info->topCard, player, choice) != ERROR_OK) {
-        printf("Invalid choice! Try again.\n");
-        printf("Please enter 0 if you want to take a card from the deck\n"
-            "or 1 - %d if you want to put one of your cards in the middle:\n", player->handSize);
-        scanf("%d", &choice);
-    }
-
-    // If the user drew a card from the deck we will enter this branch.
-    if (choice == fromDeck) {
-        // Verify wether the capacity of the deck need to be reallocated
-        if (player->handCapacity < player->handSize + 1)
-            player->deck = deckRealloc(player, player->handCapacity * 2);
-        // Making a new card of the player and inserting it into the deck
-        makePlayerCard(&player->deck[player->handSize++], getRandInRange(CARDS_RANGE));
-        // Updating the histogram
-        incHistogram(info, &player->deck[player->handSize - 1]);
-        // Assaigning TOKEN_FROM_DECK to the return value
-        tokenType = TOKEN_FROM_DEC;
-    }
-    else {
-        /////////////////// Changing the type and color of the top card ////////////////////
-        info->topCard.colour = player->deck[choice - 1].colour;
-        strcpy(info->topCard.type, player->deck[choice - 1].type);
-        ///////////////////////////////////////////////////////////////////////////////////
-        // Determining the type of the new top card
-        tokenType = mapTopType(info->topCard.type);
-        // Decresing the hand size of the current player
-        --(player->handSize);
-        // Swapping the card chosen with the card placed in the handSize index.
-        swapCards(&player->deck[choice - 1], &player->deck[player->handSize]);
+    do {
+        digits[--i] = (char)('0' + num % 10);
+        num /= 10;
+    } while (num > 0);
+    frameAppend(frame, digits + i, sizeof(digits) - i);
+}
+
+void flushFrame(Frame* frame)
+{
+    // Writing the frame to the screen with a single write and emptying it.
+
+    size_t written = 0;
+    long result;
+
+    fflush(stdout); // Anything printed before the frame must reach the screen first.
+    while (written < frame->length) {
+#ifdef _WIN32
+        result = _write(1, frame->data + written, (unsigned int)(frame->length - written));
+#else
+        result = (long)write(STDOUT_FILENO, frame->data + written, frame->length - written);
+#endif
+        if (result <= 0)
+            break;
+        written += (size_t)result;
     }
-    return tokenType;
+    frame->length = 0;
 }
 
-void setNewTopColor(Card* topCard)
+void freeFrame(Frame* frame)
 {
-    // If a COLOR card was chosen we need to assaign it a color, this function handles it.
-    // Card* topCard - A pointer to the top card.
+    free(frame->data);
+    frame->data = NULL;
+    frame->length = frame->capacity = 0;
+}
 
-    int choice;
+void displayCards(Frame* frame, Card* card)
+{
+    // Function for printing a card, the card is copied from the glyph cache into the frame.
+    // Frame* frame - The frame the card is printed to.
+    // Card* card - A pointer to the card that need to be printed
+
+    int i;
+
+    for (i = 0; i < LENGTH_CARD; i++) {
+        frameAppend(frame, glyphCache[*card][i], WIDTH_CARD);
+        frameAppend(frame, "\n", 1);
+    }
+    frameAppend(frame, "\n", 1);
+}
+
+void showPlayerHand(Frame* frame, Card* deck, int handSize)
+{
+    // Displaying the players hand, cardsPerRow cards in each row.
+    // Frame* frame - The frame the hand is printed to.
+    // Card* deck - A pointer to the players deck.
+    // int handSize - The physical size of the players deck.
+
+    int first, last, i, row;
+    size_t titleStart;
+
+    if (frame->cardsPerRow == 1) {
+        for (i = 0; i < handSize; i++) {
+            frameAppendStr(frame, "Card #");
+            frameAppendInt(frame, i + 1);
+            frameAppendStr(frame, ":\n");
+            displayCards(frame, &deck[i]);
+        }
+        return;
+    }
+
+    for (first = 0; first < handSize; first += frame->cardsPerRow) {
+        last = first + frame->cardsPerRow < handSize ? first + frame->cardsPerRow : handSize;
+
+        // The titles are padded to the width of a card, so they stay above their cards.
+        for (i = first; i < last; i++) {
+            titleStart = frame->length;
+            frameAppendStr(frame, "#");
+            frameAppendInt(frame, i + 1);
+            while (frame->length - titleStart < WIDTH_CARD)
+                frameAppend(frame, " ", 1);
+            if (i + 1 < last)
+                frameAppendStr(frame, CARD_GAP);
+        }
+        frameAppend(frame, "\n", 1);
+
+        for (row = 0; row < LENGTH_CARD; row++) {
+            for (i = first; i < last; i++) {
+                frameAppend(frame, glyphCache[deck[i]][row], WIDTH_CARD);
+                if (i + 1 < last)
+                    frameAppendStr(frame, CARD_GAP);
+            }
+            frameAppend(frame, "\n", 1);
+        }
+        frameAppend(frame, "\n", 1);
+    }
+}
+
+errorCode validateMove(GameInfo* info, Player* player, int choice)
+{
+    // Validating that the players move is indeed a valid one
+    // GameInfo* info - A pointer to the info of the game, holding the top card and the colour of the TAKI run
+    // Player* player - A pointer to the current player
+    // int choice - The users choice of a card to place on top of the top card, 0 for drawing a card
+    // Return value - If the users choice is a valid one a ERROR_OK is returned, if not then a ERROR_INVALID
+
+    if (choice < 0 || choice > player->handSize)
+        return ERROR_INVALID;
+    else if (choice == 0)
+        return ERROR_OK;
+    else if (isLegalCard(info, player->deck[choice - 1]))
+        return ERROR_OK;
+    return ERROR_INVALID;
+}
+
+token mapTopType(Card card)
+{
+    // Mapping the type of the top card to the correct token
+    // Card card - The top card
+    // Return value - A token representing the type
+
+    return cardToken[CARD_KIND(card)];
+}
+
+void swapCards(Card* c1, Card* c2)
+{
+    // Function for swapping cards
+
+    Card temp = *c1;
+    *c1 = *c2;
+    *c2 = temp;
+}
+
+int readCardChoice(GameInfo* info, Player* player)
+{
+    // Receiving the choice of a card, from the strategy of the player or from the user.
+    // GameInfo* info - A pointer to the GameInfo.
+    // Player* player - A pointer to the current player.
+    // Return value - 0 for drawing a card from the deck or the 1-based index of the card, not validated yet.
+
+    int choice = 0;
+
+    if (player->strategy != NULL)
+        return player->strategy->pickCard(info, player, player->strategy->context);
+
+    printf("Please enter 0 if you want to take a card from the deck\nor 1 - %d"
+        " if you want to put one of your cards in the middle:\n", player->handSize);
+    choice = readNumber(info);
+
+    return choice;
+}
+
+int readColorChoice(GameInfo* info, Player* player)
+{
+    // Receiving the colour of a COLOR card, from the strategy of the player or from the user.
+    // Return value - The colour, not validated yet.
+
+    int choice = 0;
+
+    if (player->strategy != NULL)
+        return player->strategy->pickColor(info, player, player->strategy->context);
 
     printf("Please enter your color choice:\n"
         "1 - Yellow\n"
         "2 - Red\n"
         "3 - Blue\n"
         "4 - Green\n");
-    scanf("%d", &choice);
+    choice = readNumber(info);
 
-    switch (choice) {
-    case COLOR_Y:
-        topCard->colour = 'Y';
-        break;
-    case COLOR_R:
-        topCard->colour = 'R';
-        break;
-    case COLOR_G:
-        topCard->colour = 'G';
-        break;
-    case COLOR_B:
-        topCard->colour = 'B';
-        break;
-    }
+    return choice;
+}
+
+int readAction(GameInfo* info, Player* player)
+{
+    // Receiving the next action of the current player, the phase of the game tells which decision it is.
+    // Return value - A colour in PHASE_PICK_COLOR, else a choice of a card.
+
+    if (info->phase == PHASE_PICK_COLOR)
+        return readColorChoice(info, player);
+    return readCardChoice(info, player);
+}
+
+bool drawToHand(GameInfo* info, Player* player)
+{
+    // Drawing a card from the deck into the hand of the player.
+    // GameInfo* info - A pointer to the GameInfo.
+    // Player* player - A pointer to the player.
+    // Return value - false if both piles of the finite deck are empty, nothing is drawn and the game can't go on.
+
+    // A full hand can't take another card, no real game gets there.
+    if (player->handSize == HAND_MAX)
+        return true;
+    // Verify wether the capacity of the deck need to be reallocated
+    if (player->handCapacity < player->handSize + 1)
+        player->deck = deckRealloc(info, player, player->handCapacity * 2 < HAND_MAX ? player->handCapacity * 2 : HAND_MAX);
+    // Making a new card of the player and inserting it into the deck
+    if (!drawCard(info, &player->deck[player->handSize]))
+        return false;
+    player->handSize++;
+    player->handHash += zobristKey(player->deck[player->handSize - 1]);
+    info->sizeHash ^= sizeKey((int)(player - info->players), player->handSize - 1) ^ sizeKey((int)(player - info->players), player->handSize);
+    if (player->counts != NULL)
+        addToCounts(player->counts, player->deck[player->handSize - 1]);
+    else if (player->handSize > MASK_CARDS)
+        countHand(&info->arena, player);
+    // Updating the histogram
+    incHistogram(info, &player->deck[player->handSize - 1]);
+    traceAction(info, player, TOKEN_FROM_DEC, player->deck[player->handSize - 1]);
+    return true;
+}
+
+token placeCard(GameInfo* info, Player* player, int choice)
+{
+    // Placing a card of the player on top of the top card, the choice must be valid.
+    // GameInfo* info - A pointer to the GameInfo.
+    // Player* player - A pointer to the current player.
+    // int choice - The 1-based index of the card.
+    // Return value - The token of the card.
+
+    // Changing the type and color of the top card, the card under it is discarded
+    discardCard(info, info->topCard);
+    info->topCard = player->deck[choice - 1];
+    player->handHash -= zobristKey(info->topCard);
+    if (player->counts != NULL)
+        removeFromCounts(player->counts, info->topCard);
+    recordEvent(info, info->topCard);
+    // Decresing the hand size of the current player
+    --(player->handSize);
+    info->sizeHash ^= sizeKey(info->currentlyPlaying, player->handSize + 1) ^ sizeKey(info->currentlyPlaying, player->handSize);
+    // Swapping the card chosen with the card placed in the handSize index.
+    swapCards(&player->deck[choice - 1], &player->deck[player->handSize]);
+    traceAction(info, player, mapTopType(info->topCard), info->topCard);
+    // Determining the type of the new top card
+    return mapTopType(info->topCard);
+}
+
+void setNewTopColor(GameInfo* info, int choice)
+{
+    // If a COLOR card was chosen we need to assaign it a color, this function handles it.
+    // GameInfo* info - A pointer to the info of the game, the colour of its top card is changed.
+    // int choice - The colour, any other choice leaves the top card as it is.
+
+    Card* topCard = &info->topCard;
+
+    if (choice >= COLOR_Y && choice <= COLOR_G)
+        *topCard = MAKE_CARD(CARD_KIND(*topCard), choice);
+    else
+        choice = NO_COLOR;
+    recordEvent(info, EVENT_COLOR + choice);
+    traceAction(info, &info->players[info->currentlyPlaying], NO_TOKEN, *topCard);
 }
 
 void updateScreen(GameInfo* info, Player* player)
@@ -517,81 +1762,130 @@ void updateScreen(GameInfo* info, Player* player)
     // GameInfo* info - We need the topCard member from the info struct
     // Player* player - A pointer to the current players, whose deck we need to print
 
-    printf("Upper card:\n\n");
-    displayCards(&info->topCard);
+    Frame* frame = info->frame;
+
+    if (info->live != NULL) {
+        updateLiveScreen(info, player);
+        return;
+    }
+
+    frameAppendStr(frame, "Upper card:\n\n");
+    displayCards(frame, &info->topCard);
+
+    frameAppendStr(frame, player->name);
+    frameAppendStr(frame, "'s turn:\n\n");
+    showPlayerHand(frame, player->deck, player->handSize);
 
-    printf("%s's turn:\n\n", player->name);
-    showPlayerHand(player->deck, player->handSize);
+    flushFrame(frame);
 }
 
-void changeGameState(GameInfo* info, Player* player, token tokenType, bool* isWinner)
+void applyTurnRule(GameInfo* info, Player* player, token tokenType)
 {
-    // A function for changing the game state accoring to the top card that was placed on the middle card stack.
-    // GameInfo* info - Pointer to the info struct.
+    // Ending the turn of the player with the rule of a token, see turnRules.
+    // GameInfo* info - Pointer to the info struct, its phase is set to the phase that follows.
     // Player* player - Pointer to the current player.
-    // token tokenType - The current token of the top card.
-    // bool* isWinned - Pointer to the 'isGameOver' variable in the game loop function.
-
-    // Dispatching to the correct handler based on the token of the top card.
-    switch (tokenType) {
-    case TOKEN_PLUS:
-        if (player->handSize == 0) {
-            makePlayerCard(player->deck, getRandInRange(CARDS_RANGE));
-            (player->handSize)++;
-            *isWinner = false;
-            incHistogram(info, &player->deck[player->handSize - 1]);
-            break;
-        }
-        else
-            // If the card is +, thus the players has an extra turn, we don't need to update any component.
+    // token tokenType - The token the turn ends with.
+
+    const TurnRule* rule = &turnRules[tokenType - TOKEN_FIRST];
+    int i;
+
+    if (player->handSize == 0) {
+        if (rule->lastCard == LAST_CARD_WINS || (rule->lastCard == LAST_CARD_DRAWS_2P && info->numOfPlayers != 2)) {
+            info->phase = PHASE_GAME_OVER;
             return;
-    case TOKEN_STOP:
-        if (info->numOfPlayers == 1)
-            return; // We dont need to do anything
-        // Regular handler
-        if (info->numOfPlayers == 2 && player->handSize == 0) {
-            makePlayerCard(player->deck, getRandInRange(CARDS_RANGE));
-            *isWinner = false;
-            (player->handSize)++;
-            rotationHandler(info);
-        }
-        else {
-            checkIfWinner(player, isWinner);
-            if (*isWinner == true) {
-                return;
-            }
-            rotationHandler(info);
-            rotationHandler(info);
         }
-        return;
-    case TOKEN_CHANGE_DIR:
-        checkIfWinner(player, isWinner);
-        if (*isWinner == true) {
+        if (!drawToHand(info, player)) {
+            info->phase = PHASE_GAME_DRAWN;
             return;
         }
+        rotationHandler(info);
+        info->phase = PHASE_PICK_CARD;
+        return;
+    }
 
-        // Changing the rotation using a ternary operator.
-        // If the rotation is true, change it to false, else change to true.
-        info->rotation = (info->rotation == true) ? false : true;
-        break;
-    case TOKEN_CHANGE_COL:
-        checkIfWinner(player, isWinner);
-        if (*isWinner == true) {
-            return;
-        }
+    if (rule->reverse) {
+        info->rotation = !info->rotation;
+        if (info->stats != NULL)
+            info->stats->flips++;
+    }
+    for (i = 0; i < rule->advance; i++)
+        rotationHandler(info);
+    if (rule->nextPhase == PHASE_TAKI_PICK) {
+        INSTR_COUNT(INSTR_TAKI_RUNS);
+        info->takiColour = CARD_COLOR(info->topCard);
+        info->takiToken = TOKEN_FROM_DEC;
+    }
+    info->phase = rule->nextPhase;
+}
 
-        setNewTopColor(&info->topCard);
-        break;
-    case TOKEN_TAKI:
-        checkIfWinner(player, isWinner);
-        if (*isWinner == true) {
-            return;
+void endTakiRun(GameInfo* info, Player* player, token tokenType)
+{
+    // Ending the TAKI run of the player, and his turn with the rule of a token.
+
+    info->takiColour = NO_COLOR;
+    recordEvent(info, EVENT_TAKI_END);
+    if (info->stats != NULL)
+        endStatsRun(info->stats);
+    applyTurnRule(info, player, tokenType);
+}
+
+errorCode step(GameInfo* info, int action)
+{
+    // The rules of the game, applying one action of the current player and moving the game to the phase that follows.
+    // A game is played by calling it until the phase is PHASE_GAME_OVER, the current player is then the winner,
+    // or PHASE_GAME_DRAWN when a card had to be drawn and there was none left.
+    // GameInfo* info - Pointer to the info of the game, its players must be set.
+    // int action - In PHASE_PICK_COLOR the colour, any other colour leaves the top card as it is.
+    //              Else 0 for drawing a card or the 1-based index of the card to place.
+    // Return value - ERROR_INVALID if the card can't be placed or the game is over, the game isn't changed. Else ERROR_OK.
+
+    Player* player = &info->players[info->currentlyPlaying];
+    token tokenType;
+
+    if (info->phase == PHASE_PICK_COLOR) {
+        setNewTopColor(info, action);
+        // The turn passes as after a regular card.
+        applyTurnRule(info, player, TOKEN_REG);
+        return ERROR_OK;
+    }
+    if (info->phase == PHASE_GAME_OVER || info->phase == PHASE_GAME_DRAWN || validateMove(info, player, action) != ERROR_OK)
+        return ERROR_INVALID;
+
+    if (action == 0) {
+        if (!drawToHand(info, player)) {
+            info->phase = PHASE_GAME_DRAWN;
+            return ERROR_OK;
         }
+        tokenType = TOKEN_FROM_DEC;
+    }
+    else
+        tokenType = placeCard(info, player, action);
 
-        takiHandler(info, player, isWinner);
-        return;
+    if (info->phase == PHASE_PICK_CARD) {
+        applyTurnRule(info, player, tokenType);
+        return ERROR_OK;
+    }
+
+    // Inside a TAKI run, a player who empties his hand ends it.
+    if (action != 0) {
+        INSTR_COUNT(INSTR_TAKI_CARDS);
+        if (info->stats != NULL)
+            info->stats->runCards++;
+    }
+    switch (turnRules[tokenType - TOKEN_FIRST].inRun) {
+    case RUN_CONTINUE:
+        info->takiToken = tokenType;
+        if (player->handSize == 0)
+            endTakiRun(info, player, tokenType);
+        break;
+    case RUN_END_LAST:
+        endTakiRun(info, player, info->takiToken);
+        break;
+    case RUN_END:
+        endTakiRun(info, player, tokenType);
+        break;
     }
-    rotationHandler(info);
+    return ERROR_OK;
 }
 
 void rotationHandler(GameInfo* info)
@@ -616,110 +1910,55 @@ void rotationHandler(GameInfo* info)
     }
 }
 
-errorCode validateMoveOnTaki(GameInfo* info, char takiColour)
-{
-    // Function for validating the users move when the top card that was placed is the TAKI card.
-    // Card* topCard - A pointer to the top card.
-    // char takiColour - The colour of the TAKI card.
-    // Return value - If the 'move' is valid it returns an ERROR_OK, else ERROR_INVALID
-
-    if (strcmp(info->topCard.type, STR_CHANGE_COL) == 0) {
-        return ERROR_OK;
-    }
-    if (info->topCard.colour != takiColour)
-        return ERROR_INVALID;
-    return ERROR_OK;
-}
-
-void takiHandler(GameInfo* info, Player* player, bool* isWinner)
+int gameLoop(GameInfo* info, Player* players)
 {
-    // The handler for the TAKI card.
-    // GameInfo* info - A pointer to the info of the game.
-    // Player* player - A pointer to the current player.
-    // bool* isWinner - A pointer to the 'isGameOver' var in the gameLoop function, the player may win the game while in TAKI mode.
-
-    int idx;
-    char takiColour = info->topCard.colour; // Copy of the top cards colour.
-    token returnedToken, prevToken = TOKEN_FROM_DEC; // For storing the value returned from 'makeAMove'.
+    // The loop of the game, played from the current state of the info until one of the players wins.
+    // GameInfo* info - Pointer to the info of the game.
+    // Players* players - Pointer to the array of players
+    // Return value - The index of the winner, or NO_WINNER if the game ended in a draw.
 
-    checkIfWinner(player, isWinner);
-    if (*isWinner == true)
-        return;
+    Player* player;
+    bool invalid = false;
+    int action, winner;
 
-    while ((returnedToken = makeAMove(info, player)) != TOKEN_FROM_DEC && returnedToken != TOKEN_CHANGE_COL) {
-        idx = player->handSize;
-        prevToken = returnedToken;
-        checkIfWinner(player, isWinner);
+    if (!info->headless)
+        printf("\n");
 
-        if (*isWinner == true) {
-            break;
+    info->players = players;
+    countHands(info, players);
+    hashSizes(info, players);
+
+    // The actual loop of the game, one action at a time.
+    while (info->phase != PHASE_GAME_OVER && info->phase != PHASE_GAME_DRAWN) {
+        player = &players[info->currentlyPlaying];
+        if (!info->headless && !invalid && info->phase != PHASE_PICK_COLOR)
+            INSTR_TIME(INSTR_RENDER, updateScreen(info, player));
+
+        INSTR_TIME(INSTR_DECIDE, action = readAction(info, player));
+        INSTR_TIME(INSTR_RULES, invalid = step(info, action) != ERROR_OK);
+        if (invalid)
+            INSTR_COUNT(INSTR_RETRIES);
+        if (invalid && player->strategy != NULL) {
+            // A strategy is not asked again, an invalid choice is treated as drawing a card.
+            step(info, 0);
+            invalid = false;
         }
-
-        if (validateMoveOnTaki(info, takiColour) == ERROR_INVALID) {
+        else if (invalid)
             printf("Invalid choice! Try again.\n");
-            ++(player->handSize);
-            swapCards(&info->topCard, &player->deck[idx + 1]);
-        }
-        else {
-            info->topCard.colour = player->deck[idx].colour;
-            strcpy(info->topCard.type, player->deck[idx].type);
-            updateScreen(info, player);
-        }
-    }
-
-    if (returnedToken == TOKEN_CHANGE_COL) {
-        changeGameState(info, player, returnedToken, isWinner);
-    }
-    else {
-        // Instead of creating another function for handling each top card placed at the end of the TAKI
-        // we can make a recursive call (we are already in the call chain of changeGameState) to the changeGameState to update the gameInfo accordingly.
-        changeGameState(info, player, prevToken, isWinner);
+        if (!invalid && info->stats != NULL)
+            info->stats->moves++;
     }
-}
-
-void checkIfWinner(Player* player, bool* isGameOver)
-{
-    // If the physical handsize of the player is 0, he won the game, thus we need to notify the game loop that the game has ended.
-    // Player* player - Pointer to the current player.
-    // bool* isWinner - A pointer to the 'isGameOver' var in the gameLoop function.
-
-    if (player->handSize == 0)
-        *isGameOver = true;
-}
-
-void gameLoop(GameInfo* info, Player* players)
-{
-    // The loop of the game.
-    // GameInfo* info - Pointer to the info of the game.
-    // Players* players - Pointer to the array of players
-
-    int i;
-    token currentToken;
-    bool isGameOver = false;
-
-    printf("\n");
-
-    info->currentlyPlaying = FIRST_PLAYER;
-    info->rotation = true;
 
-    // The actual loop of the game.
-    while (isGameOver != true) {
-        i = info->currentlyPlaying;
-        printf("Upper card:\n\n");
-        displayCards(&info->topCard);
+    winner = info->phase == PHASE_GAME_DRAWN ? NO_WINNER : info->currentlyPlaying;
+    recordEvent(info, EVENT_GAME_END);
+    recordEvent(info, (unsigned char)winner);
 
-        printf("%s's turn:\n\n", players[i].name);
-        showPlayerHand(players[i].deck, players[i].handSize);
-        currentToken = makeAMove(info, &players[info->currentlyPlaying]);
+    if (!info->headless && winner == NO_WINNER)
+        printf("The deck is empty, nobody wins !\n");
+    else if (!info->headless)
+        printf("The winner is... %s! Congratulations !\n", players[winner].name);
 
-        if (currentToken == TOKEN_TAKI)
-            updateScreen(info, &players[i]);
-
-        changeGameState(info, &players[i], currentToken, &isGameOver);
-        checkIfWinner(&players[i], &isGameOver);
-    }
-
-    printf("The winner is... %s! Congratulations !\n", players[i].name);
+    return winner;
 }
 
 void checkCardAlloc(Card* newDeck)
@@ -758,233 +1997,4937 @@ void copyDeck(Card* dest, Card* source, int copySize)
     }
 }
 
-Card* deckRealloc(Player* player, int newSize)
+Card* deckRealloc(GameInfo* info, Player* player, int newSize)
 {
     // Reallocating the new deck.
+    // GameInfo* info - Pointer to the game info, the deck is taken from its arena.
     // Player* player - Pointer to the current player.
     // int newSize - The size of the new deck.
 
     Card* newDeck = NULL;
 
-    if (newSize == 0) { // For freeing the decks later
-        free(player->deck);
-        return NULL;
+    INSTR_COUNT(INSTR_DECK_REALLOC);
+
+    // The old deck stays in the arena until the next game, there is nothing to free.
+    if (arenaExtend(&info->arena, player->deck, player->handCapacity, newSize)) {
+        player->handCapacity = newSize;
+        return player->deck;
     }
 
-    newDeck = (Card*)malloc(sizeof(Card) * newSize);
-    checkCardAlloc(newDeck);
+    newDeck = arenaAlloc(&info->arena, newSize);
     player->handCapacity = newSize;
-
-    // Im copying the last to cards in the deck, because is use one of them in my taki handler.
-    copyDeck(newDeck, player->deck, player->handSize + 2);
-    free(player->deck);
+    copyDeck(newDeck, player->deck, player->handSize);
 
     return newDeck;
 }
 
-void initHistogram(GameInfo* info)
-{
-    // Initializing the histogram
-    // GameInfo* info - Pointer to the game info.
-
-    int i;
+///////////////////////////////// Live screen ////////////////////////////////////////////////////////////
 
-    for (i = 0; i < CARDS_RANGE; i++) {
-        if (i < 9) {
-            info->histogram[i].type[0] = ((i + 1) + ZERO_CHAR);
-            info->histogram[i].type[1] = NULL_CHAR;
-        }
-        else {
-            switch ((i + 1)) {
-            case TOKEN_CHANGE_COL:
-                strcpy(info->histogram[i].type, "COLOR");
-                break;
-            case TOKEN_CHANGE_DIR:
-                strcpy(info->histogram[i].type, "<->");
-                break;
-            case TOKEN_PLUS:
-                strcpy(info->histogram[i].type, "+");
-                break;
-            case TOKEN_STOP:
-                strcpy(info->histogram[i].type, "STOP");
-                break;
-            case TOKEN_TAKI:
-                strcpy(info->histogram[i].type, "TAKI");
-                break;
-            }
-        }
-        info->histogram[i].count = INIT_HISTO;
-    }
-}
-
-int returnCardIndex(Card* card)
-{
-    // Returning the index of the card based on his type
-    // Card* card - Pointer to the card.
-
-    // We only need the first char of the card.
-    char type = card->type[0];
-
-    switch (type) {
-    case CARD_1:
-        return CASE_CARD_1;
-    case CARD_2:
-        return CASE_CARD_2;
-    case CARD_3:
-        return CASE_CARD_3;
-    case CARD_4:
-        return CASE_CARD_4;
-    case CARD_5:
-        return CASE_CARD_5;
-    case CARD_6:
-        return CASE_CARD_6;
-    case CARD_7:
-        return CASE_CARD_7;
-    case CARD_8:
-        return CASE_CARD_8;
-    case CARD_9:
-        return CASE_CARD_9;
-    case CARD_PLUS:
-        return CASE_CARD_10;
-    case CARD_STOP:
-        return CASE_CARD_11;
-    case CARD_CH_DIR:
-        return CASE_CARD_12;
-    case CARD_TAKI:
-        return CASE_CARD_13;
-    case CARD_CH_COL:
-        return CASE_CARD_14;
+void initLiveScreen(LiveScreen* live, int numOfPlayers, int cardsPerRow)
+{
+    // Initializing the live display, nothing is drawn until the first update.
+    // LiveScreen* live - Pointer to the live display.
+    // int numOfPlayers - The amount of players, each one gets a line.
+    // int cardsPerRow - The amount of cards side by side.
+
+#ifdef _WIN32
+    // The console of Windows understands the escape sequences only when asked to.
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+
+    if (GetConsoleMode(console, &mode))
+        SetConsoleMode(console, mode | 0x0004); // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#endif
+
+    live->seatSizes = (int*)malloc(sizeof(int) * numOfPlayers);
+    if (live->seatSizes == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
     }
+    live->numOfSeats = numOfPlayers;
+    live->cardsPerRow = cardsPerRow > 0 ? cardsPerRow : LIVE_DEFAULT_CARDS;
+    live->shown = NULL;
+    live->rows = 0;
+    live->turn = -1;
 }
 
-void incHistogram(GameInfo* info, Card* drawnCard)
+void freeLiveScreen(LiveScreen* live)
 {
-    // Incrementing the histogram
-    // GameInfo* info - Pointer to the game info.
-    // Card* drawnCard - The new card created and placed in the current players deck.
-
-    int cardIndex = returnCardIndex(drawnCard);
-    info->histogram[cardIndex].count++;
+    free(live->seatSizes);
+    free(live->shown);
+    live->seatSizes = NULL;
+    live->shown = NULL;
+    live->numOfSeats = 0;
 }
 
-void initGameInfo(GameInfo* info)
+void frameAppendMove(Frame* frame, int line, int column)
 {
-    // Initialzing the game info
-    // GameInfo* info - Pointer to the game info.
+    // Appending the escape sequence that moves the cursor, the lines and the columns start from 1.
 
-    initTopCard(&info->topCard, getRandInRange(9));
-    initHistogram(info);
+    frameAppendStr(frame, "\x1b[");
+    frameAppendInt(frame, line);
+    frameAppend(frame, ";", 1);
+    frameAppendInt(frame, column);
+    frameAppend(frame, "H", 1);
 }
 
-
-///////////////////////////////// Functions for the merge sort ///////////////////////////////////////////
-
-void merge(Histogram* arr1, int size1, Histogram* arr2, int size2, Histogram* temp)
+void layoutLiveScreen(LiveScreen* live)
 {
-    int i, j, k;
+    // Placing the hand under the lines of the seats and forgetting what is on the screen, the next update draws everything.
 
-    i = j = k = 0;
-    while (i < size1 && j < size2) {
-        if (arr1[i].count >= arr2[j].count)
-            temp[k++] = arr1[i++];
-        else
-            temp[k++] = arr2[j++];
-    }
+    int i;
 
-    while (i < size1)
-        temp[k++] = arr1[i++];
-    while (j < size2)
-        temp[k++] = arr2[j++];
+    for (i = 0; i < live->numOfSeats; i++)
+        live->seatSizes[i] = -1;
+    live->handLine = LIVE_FIRST_SEAT + live->numOfSeats + 1;
+    live->shownSize = -1;
+    live->promptLine = live->handLine + live->rows * LIVE_ROW_LINES;
+    live->topCard = -1;
+    live->turn = -1;
 }
 
-void copyDataFromTemp(Histogram* dest, Histogram* source, int size)
+void drawLiveSlot(Frame* frame, LiveScreen* live, int slot, Card* card)
 {
-    while (size > 0) {
-        *dest++ = *source++;
-        size--;
+    // Drawing the card in a slot of the hand, with its title.
+    // int slot - The 0-based index of the card in the hand.
+    // Card* card - The card, NULL clears the slot.
+
+    int line = live->handLine + (slot / live->cardsPerRow) * LIVE_ROW_LINES;
+    int column = 1 + (slot % live->cardsPerRow) * (WIDTH_CARD + (int)strlen(CARD_GAP));
+    size_t titleStart;
+    int i;
+
+    // The titles are padded to the width of a card, so a shorter title covers a longer one.
+    frameAppendMove(frame, line, column);
+    titleStart = frame->length;
+    if (card != NULL) {
+        frameAppendStr(frame, "#");
+        frameAppendInt(frame, slot + 1);
+    }
+    while (frame->length - titleStart < WIDTH_CARD)
+        frameAppend(frame, " ", 1);
+
+    for (i = 0; i < LENGTH_CARD; i++) {
+        frameAppendMove(frame, line + 1 + i, column);
+        if (card != NULL)
+            frameAppend(frame, glyphCache[*card][i], WIDTH_CARD);
+        else
+            frameAppendStr(frame, "         ");
     }
 }
 
-void mergeSort(Histogram* data, int size)
+void updateLiveScreen(GameInfo* info, Player* player)
 {
-    // If the size <= 1 the data is sorted
-    if (size <= 1)
-        return;
+    // Updating the live display after each action, only the parts that changed are sent to the screen:
+    // the top card, the banner, the amount of cards of a seat and the slots of the hand whose card changed.
+    // The other seats are shown only by the size of their hands, a new turn draws the hand of the next player over the last one.
+    // GameInfo* info - Pointer to the info of the game, its players and its live display.
+    // Player* player - A pointer to the current player.
+
+    Frame* frame = info->frame;
+    LiveScreen* live = info->live;
+    Player* seat;
+    Card* newShown;
+    int p, i, rows, last;
+    bool relayout = live->turn < 0;
+
+    // A hand that doesn't fit gets another row, the rows never shrink.
+    rows = (player->handSize + live->cardsPerRow - 1) / live->cardsPerRow;
+    rows = rows > 0 ? rows : 1;
+    if (rows > live->rows) {
+        newShown = (Card*)realloc(live->shown, sizeof(Card) * rows * live->cardsPerRow);
+        if (newShown == NULL) {
+            printf("Error: Could not allocate memory !\n");
+            exit(1);
+        }
+        live->shown = newShown;
+        live->rows = rows;
+        relayout = true;
+    }
+    if (relayout) {
+        layoutLiveScreen(live);
+        frameAppendStr(frame, "\x1b[2J\x1b[H" "Upper card:");
+    }
 
-    mergeSort(data, size / 2);
-    mergeSort(data + size / 2, size - size / 2);
+    if (info->topCard != live->topCard) {
+        for (i = 0; i < LENGTH_CARD; i++) {
+            frameAppendMove(frame, LIVE_TOP_LINE + i, 1);
+            frameAppend(frame, glyphCache[info->topCard][i], WIDTH_CARD);
+        }
+        live->topCard = info->topCard;
+    }
 
-    Histogram* temp = (Histogram*)malloc(sizeof(Histogram) * size);
+    if (info->currentlyPlaying != live->turn) {
+        frameAppendMove(frame, LIVE_BANNER_LINE, 1);
+        frameAppendStr(frame, player->name);
+        frameAppendStr(frame, "'s turn:\x1b[K");
+        live->turn = info->currentlyPlaying;
+    }
 
-    if (temp == NULL) {
-        printf("Error: Memory allocation failed !");
-        exit(EXIT_FAILURE);
+    for (p = 0; p < live->numOfSeats; p++) {
+        seat = &info->players[p];
+        if (seat->handSize != live->seatSizes[p]) {
+            frameAppendMove(frame, LIVE_FIRST_SEAT + p, 1);
+            frameAppendStr(frame, seat->name);
+            frameAppendStr(frame, " - ");
+            frameAppendInt(frame, seat->handSize);
+            frameAppendStr(frame, seat->handSize == 1 ? " card\x1b[K" : " cards\x1b[K");
+            live->seatSizes[p] = seat->handSize;
+        }
     }
 
-    merge(data, size / 2, data + size / 2, size - size / 2, temp);
-    copyDataFromTemp(data, temp, size);
+    last = player->handSize > live->shownSize ? player->handSize : live->shownSize;
+    for (i = 0; i < last; i++) {
+        if (i >= player->handSize)
+            drawLiveSlot(frame, live, i, NULL);
+        else if (i >= live->shownSize || live->shown[i] != player->deck[i]) {
+            drawLiveSlot(frame, live, i, &player->deck[i]);
+            live->shown[i] = player->deck[i];
+        }
+    }
+    live->shownSize = player->handSize;
 
-    free(temp);
-    temp = NULL;
+    // Clearing the questions of the previous turn, the next ones are asked under the hand.
+    frameAppendMove(frame, live->promptLine, 1);
+    frameAppendStr(frame, "\x1b[J");
+    flushFrame(frame);
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void sortHistogram(GameInfo* info)
+///////////////////////////////// Arena allocator for the hands ///////////////////////////////////////////
+
+void initArena(HandArena* arena, size_t capacity)
 {
-    mergeSort(info->histogram, CARDS_RANGE);
+    // Initializing an empty arena.
+    // HandArena* arena - Pointer to the arena.
+    // size_t capacity - The amount of cards the arena holds before taking memory from the heap.
+
+    arena->base = (Card*)malloc(sizeof(Card) * capacity);
+    checkCardAlloc(arena->base);
+    arena->used = 0;
+    arena->capacity = capacity;
+    arena->overflowCards = 0;
+    arena->overflow = NULL;
 }
 
-void printHistogram(GameInfo* info)
+Card* arenaAlloc(HandArena* arena, size_t count)
 {
-    // Function for printing the histogram
-    // GameInfo* info - A pointer to the game info.
-    int i;
+    // Allocating a block of cards from the arena.
+    // Return value - Pointer to the first card of the block.
 
-    printf("\n************ Game Statistics ************\n"
-        "Card # | Frequency\n"
-        "__________________\n");
+    ArenaBlock* block;
 
-    for (i = 0; i < CARDS_RANGE; i++) {
-        printf("%6s | %d\n", info->histogram[i].type, info->histogram[i].count);
+    if (arena->used + count <= arena->capacity) {
+        arena->used += count;
+        return arena->base + arena->used - count;
     }
+
+    // The region is full, the block is taken from the heap until the next reset.
+    block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + sizeof(Card) * count);
+    if (block == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    block->next = arena->overflow;
+    arena->overflow = block;
+    arena->overflowCards += count;
+
+    return block->cards;
 }
 
-void exitGame(GameInfo* info, Player* players)
+bool arenaExtend(HandArena* arena, Card* block, size_t oldCount, size_t newCount)
 {
-    // Function for exiting the game, i.e freeing the memory and for sorting and printing the histogram.
-    // GameInfo* info - Pointer to the game info.
-    // Player* players - Pointer to the array of players.
+    // Growing a block in place, possible only when it is the last block of the region and there is room after it.
+    // Return value - true if the block was extended, false if it has to be moved.
 
+    if (block + oldCount != arena->base + arena->used || arena->used - oldCount + newCount > arena->capacity)
+        return false;
+
+    arena->used += newCount - oldCount;
+    return true;
+}
+
+void resetArena(HandArena* arena)
+{
+    // Freeing every block of the arena at once, every deck taken from it becomes invalid.
+    // If the last game needed the heap, the region is replaced with one that fits twice as much.
+
+    ArenaBlock* block;
+    size_t needed = arena->used + arena->overflowCards;
+
+    if (arena->overflow != NULL) {
+        while (arena->overflow != NULL) {
+            block = arena->overflow;
+            arena->overflow = block->next;
+            free(block);
+        }
+        free(arena->base);
+        arena->capacity = needed * 2;
+        arena->base = (Card*)malloc(sizeof(Card) * arena->capacity);
+        checkCardAlloc(arena->base);
+        arena->overflowCards = 0;
+    }
+    arena->used = 0;
+}
+
+void freeArena(HandArena* arena)
+{
+    resetArena(arena);
+    free(arena->base);
+    arena->base = NULL;
+    arena->capacity = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Finite deck ///////////////////////////////////////////////////////////
+
+void shuffleCards(Rng* rng, Card* cards, int count)
+{
+    // Shuffling cards in place with Fisher-Yates, every order has the same chance.
+
+    int i, j;
+
+    for (i = count - 1; i > 0; i--) {
+        j = getRandInRange(rng, i + 1) - 1;
+        swapCards(&cards[i], &cards[j]);
+    }
+}
+
+void shuffleDeck(GameInfo* info)
+{
+    // Starting a game with the whole finite deck shuffled into the draw pile, nothing is done when the cards are made at random.
+    // The top card is the last number card of the pile, taken before the hands are dealt so a small deck can't run out of them.
+    // The buffer of the piles is allocated by the first game and kept for the next ones.
+    // GameInfo* info - Pointer to the info of the game, the deck is shuffled with its generator and its top card is set.
+
+    Deck* deck = &info->deck;
+    int i;
+
+    if (numOfDeckCards == 0)
+        return;
+    if (deck->cards == NULL) {
+        deck->cards = (Card*)malloc(sizeof(Card) * numOfDeckCards);
+        checkCardAlloc(deck->cards);
+        deck->size = numOfDeckCards;
+    }
+
+    memcpy(deck->cards, deckTemplate, numOfDeckCards);
+    shuffleCards(&info->rng, deck->cards, numOfDeckCards);
+    deck->drawCount = numOfDeckCards;
+    deck->discardCount = 0;
+
+    // validateRuleSet makes sure the deck has a number card.
+    for (i = deck->drawCount - 1; CARD_KIND(deck->cards[i]) > KIND_9; i--)
+        ;
+    swapCards(&deck->cards[i], &deck->cards[deck->drawCount - 1]);
+    info->topCard = deck->cards[--deck->drawCount];
+}
+
+bool drawFromDeck(GameInfo* info, Card* card)
+{
+    // Taking the last card of the draw pile, the discard pile is shuffled into a new draw pile when it runs out.
+    // GameInfo* info - Pointer to the info of the game.
+    // Card* card - Set to the card.
+    // Return value - false if both piles are empty, every card of the deck is in a hand or on top.
+
+    Deck* deck = &info->deck;
+
+    if (deck->drawCount == 0) {
+        if (deck->discardCount == 0)
+            return false;
+        memmove(deck->cards, deck->cards + deck->size - deck->discardCount, deck->discardCount);
+        shuffleCards(&info->rng, deck->cards, deck->discardCount);
+        deck->drawCount = deck->discardCount;
+        deck->discardCount = 0;
+    }
+
+    *card = deck->cards[--deck->drawCount];
+    return true;
+}
+
+void discardCard(GameInfo* info, Card card)
+{
+    // Putting a card that left the top of the pile on the discard pile, a COLOR card loses the colour it was given.
+    // The card came from the deck, so the buffer has room for it unless a card was made outside of the deck.
+
+    Deck* deck = &info->deck;
+
+    if (deck->cards == NULL)
+        return;
+    if (deck->drawCount + deck->discardCount == deck->size) {
+        printf("Error: A card was discarded into a full deck !\n");
+        exit(1);
+    }
+    if (kindFlags[CARD_KIND(card)] & KIND_FLAG_WILD)
+        card = MAKE_CARD(CARD_KIND(card), NO_COLOR);
+    deck->cards[deck->size - ++deck->discardCount] = card;
+}
+
+void freeDeck(Deck* deck)
+{
+    free(deck->cards);
+    deck->cards = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Name pool /////////////////////////////////////////////////////////////
+
+NamePool namePool;
+once_flag namePoolOnce = ONCE_FLAG_INIT;
+
+void initNamePool()
+{
+    // Initializing the empty pool, called once by the first internName.
+
+    namePool.numOfSlots = NAME_INIT_SLOTS;
+    namePool.slots = (const char**)calloc(namePool.numOfSlots, sizeof(const char*));
+    if (namePool.slots == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    namePool.numOfNames = 0;
+    namePool.bytes = sizeof(const char*) * namePool.numOfSlots;
+    namePool.blocks = NULL;
+    mtx_init(&namePool.lock, mtx_plain);
+}
+
+uint64_t hashName(const char* name)
+{
+    // Hashing a name with FNV-1a.
+    // const char* name - The name.
+    // Return value - The hash of the name.
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    while (*name != '\0') {
+        hash ^= (unsigned char)*name++;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+const char* internName(const char* name)
+{
+    // Finding the copy of a name in the pool, the name is copied into the pool the first time it is seen.
+    // const char* name - The name.
+    // Return value - The copy of the name, valid until the program exits.
+
+    const char** slots;
+    const char* copy;
+    NameBlock* block;
+    size_t length = strlen(name) + 1;
+    size_t mask, i, j;
+
+    call_once(&namePoolOnce, initNamePool);
+    mtx_lock(&namePool.lock);
+
+    mask = namePool.numOfSlots - 1;
+    for (i = hashName(name) & mask; namePool.slots[i] != NULL; i = (i + 1) & mask) {
+        if (strcmp(namePool.slots[i], name) == 0) {
+            copy = namePool.slots[i];
+            mtx_unlock(&namePool.lock);
+            return copy;
+        }
+    }
+
+    // The name is new, it is copied to the current block or to a new one when it doesn't fit.
+    block = namePool.blocks;
+    if (block == NULL || block->used + length > block->capacity) {
+        block = (NameBlock*)malloc(sizeof(NameBlock) + (length > NAME_BLOCK ? length : NAME_BLOCK));
+        if (block == NULL) {
+            printf("Error: Could not allocate memory !\n");
+            exit(1);
+        }
+        block->used = 0;
+        block->capacity = length > NAME_BLOCK ? length : NAME_BLOCK;
+        block->next = namePool.blocks;
+        namePool.blocks = block;
+        namePool.bytes += sizeof(NameBlock) + block->capacity;
+    }
+    memcpy(block->data + block->used, name, length);
+    copy = block->data + block->used;
+    block->used += length;
+    namePool.slots[i] = copy;
+    namePool.numOfNames++;
+
+    // The table is kept at most half full, it is doubled and every name is placed again.
+    if (namePool.numOfNames * 2 > namePool.numOfSlots) {
+        slots = (const char**)calloc(namePool.numOfSlots * 2, sizeof(const char*));
+        if (slots == NULL) {
+            printf("Error: Could not allocate memory !\n");
+            exit(1);
+        }
+        mask = namePool.numOfSlots * 2 - 1;
+        for (i = 0; i < namePool.numOfSlots; i++) {
+            if (namePool.slots[i] == NULL)
+                continue;
+            for (j = hashName(namePool.slots[i]) & mask; slots[j] != NULL; j = (j + 1) & mask);
+            slots[j] = namePool.slots[i];
+        }
+        free(namePool.slots);
+        namePool.bytes += sizeof(const char*) * namePool.numOfSlots;
+        namePool.slots = slots;
+        namePool.numOfSlots *= 2;
+    }
+
+    mtx_unlock(&namePool.lock);
+    return copy;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void initHistogram(Histogram* histogram)
+{
+    // Initializing the histogram
+    // Histogram* histogram - Pointer to the histogram.
+
+    int i;
+
+    for (i = 0; i < CARDS_RANGE; i++)
+        histogram->count[i] = INIT_HISTO;
+}
+
+void incHistogram(GameInfo* info, Card* drawnCard)
+{
+    // Incrementing the histogram
+    // GameInfo* info - Pointer to the game info.
+    // Card* drawnCard - The new card created and placed in the current players deck.
+
+    // The kind of the card is its index in the histogram.
+    info->histogram.count[CARD_KIND(*drawnCard)]++;
+    recordEvent(info, EVENT_DRAW + *drawnCard);
+}
+
+void mergeHistogram(Histogram* dest, Histogram* source)
+{
+    // Adding the counters of one histogram to another, i.e the histograms of several games or threads.
+
+    int i;
+
+    for (i = 0; i < CARDS_RANGE; i++)
+        dest->count[i] += source->count[i];
+}
+
+void initGameInfo(GameInfo* info)
+{
+    // Initialzing the game info
+    // GameInfo* info - Pointer to the game info.
+
+    dealTopCard(info);
+    initHistogram(&info->histogram);
+    info->currentlyPlaying = FIRST_PLAYER;
+    info->rotation = true;
+    info->phase = PHASE_PICK_CARD;
+    info->takiColour = NO_COLOR;
+}
+
+void sortHistogram(Histogram* histogram, unsigned char rank[CARDS_RANGE])
+{
+    // Ranking the kinds from the most frequent to the least, the counters themselves are not moved,
+    // so the histogram can keep counting and be ranked again at any time.
+    // Histogram* histogram - Pointer to the histogram.
+    // unsigned char rank - Filled with the kinds, in order. Equal counters keep the order of the kinds.
+
+    int i, j;
+    unsigned char kind;
+
+    // An insertion sort, for 14 entries it beats anything that needs extra memory.
+    for (i = 0; i < CARDS_RANGE; i++) {
+        kind = (unsigned char)i;
+        for (j = i; j > 0 && histogram->count[rank[j - 1]] < histogram->count[kind]; j--)
+            rank[j] = rank[j - 1];
+        rank[j] = kind;
+    }
+}
+
+void printHistogram(Histogram* histogram)
+{
+    // Function for printing the histogram, ranked from the most frequent card.
+    // Histogram* histogram - A pointer to the histogram.
+    int i;
+    unsigned char rank[CARDS_RANGE];
+
+    sortHistogram(histogram, rank);
+
+    printf("\n************ Game Statistics ************\n"
+        "Card # | Frequency\n"
+        "__________________\n");
+
+    for (i = 0; i < CARDS_RANGE; i++) {
+        printf("%6s | %lld\n", cardTypeStr[rank[i]], histogram->count[rank[i]]);
+    }
+}
+
+void exitGame(GameInfo* info, Player* players)
+{
+    // Function for exiting the game, i.e freeing the memory and for printing the histogram.
+    // GameInfo* info - Pointer to the game info.
+    // Player* players - Pointer to the array of players.
+
+    int i;
+
+    // The decks are all in the arena, freeing it frees them.
+    freeArena(&info->arena);
+    freeDeck(&info->deck);
+    for (i = 0; i < info->numOfPlayers; i++)
+        players[i].deck = NULL;
+
+    printHistogram(&info->histogram);
+    INSTR_DUMP();
+}
+
+///////////////////////////////// Game snapshots ///////////////////////////////////////////////////////////
+
+errorCode snapshotGame(GameInfo* info, Player* players, GameSnapshot* snapshot)
+{
+    // Taking a snapshot of the position of a game, the histogram and the screen are not part of it.
+    // GameInfo* info - Pointer to the info of the game.
+    // Player* players - Pointer to the array of players.
+    // GameSnapshot* snapshot - Filled with the position.
+    // Return value - ERROR_INVALID if the game has too many players or cards for a snapshot, else ERROR_OK.
+
+    Deck* deck = &info->deck;
+    int i, numOfCards = deck->drawCount + deck->discardCount;
+
+    if (info->numOfPlayers > SNAPSHOT_MAX_PLAYERS)
+        return ERROR_INVALID;
+    for (i = 0; i < info->numOfPlayers; i++)
+        numOfCards += players[i].handSize;
+    if (numOfCards > SNAPSHOT_MAX_CARDS)
+        return ERROR_INVALID;
+
+    snapshot->rng = info->rng;
+    snapshot->botRng = info->botRng;
+    snapshot->numOfPlayers = (unsigned char)info->numOfPlayers;
+    snapshot->currentlyPlaying = (unsigned char)info->currentlyPlaying;
+    snapshot->rotation = info->rotation;
+    snapshot->phase = info->phase;
+    snapshot->takiColour = info->takiColour;
+    snapshot->takiToken = (unsigned char)info->takiToken;
+    snapshot->topCard = info->topCard;
+    snapshot->numOfCards = (unsigned short)numOfCards;
+
+    numOfCards = 0;
+    for (i = 0; i < info->numOfPlayers; i++) {
+        snapshot->handSize[i] = (unsigned short)players[i].handSize;
+        memcpy(snapshot->cards + numOfCards, players[i].deck, players[i].handSize);
+        numOfCards += players[i].handSize;
+    }
+    snapshot->drawCount = (unsigned short)deck->drawCount;
+    snapshot->discardCount = (unsigned short)deck->discardCount;
+    if (deck->cards != NULL) {
+        memcpy(snapshot->cards + numOfCards, deck->cards, deck->drawCount);
+        memcpy(snapshot->cards + numOfCards + deck->drawCount, deck->cards + deck->size - deck->discardCount, deck->discardCount);
+    }
+    return ERROR_OK;
+}
+
+void restoreGame(GameInfo* info, Player* players, GameSnapshot* snapshot)
+{
+    // Restoring the position of a game from a snapshot.
+    // The arena of the game is reset and every hand is taken from it again, so every deck of the game before the restore becomes invalid.
+    // GameInfo* info - Pointer to the info of the game.
+    // Player* players - Pointer to the array of players, at least as many as in the snapshot.
+    // GameSnapshot* snapshot - The position.
+
+    Card* cards = snapshot->cards;
+    int i;
+
+    info->rng = snapshot->rng;
+    info->botRng = snapshot->botRng;
+    info->numOfPlayers = snapshot->numOfPlayers;
+    info->currentlyPlaying = snapshot->currentlyPlaying;
+    info->rotation = snapshot->rotation;
+    info->phase = snapshot->phase;
+    info->takiColour = snapshot->takiColour;
+    info->takiToken = snapshot->takiToken;
+    info->topCard = snapshot->topCard;
+    info->players = players;
+
+    resetArena(&info->arena);
+    for (i = 0; i < snapshot->numOfPlayers; i++) {
+        players[i].handSize = snapshot->handSize[i];
+        players[i].handCapacity = players[i].handSize > dealSize ? players[i].handSize : dealSize;
+        players[i].deck = arenaAlloc(&info->arena, players[i].handCapacity);
+        memcpy(players[i].deck, cards, players[i].handSize);
+        players[i].handHash = hashHand(&players[i]);
+        cards += players[i].handSize;
+    }
+    countHands(info, players);
+    hashSizes(info, players);
+
+    // The piles of a finite deck, the buffer is allocated by the first restore.
+    if (numOfDeckCards > 0) {
+        if (info->deck.cards == NULL) {
+            info->deck.cards = (Card*)malloc(sizeof(Card) * numOfDeckCards);
+            checkCardAlloc(info->deck.cards);
+            info->deck.size = numOfDeckCards;
+        }
+        info->deck.drawCount = snapshot->drawCount;
+        info->deck.discardCount = snapshot->discardCount;
+        memcpy(info->deck.cards, cards, snapshot->drawCount);
+        memcpy(info->deck.cards + info->deck.size - snapshot->discardCount, cards + snapshot->drawCount, snapshot->discardCount);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Zobrist hashing ///////////////////////////////////////////////////////////
+
+uint64_t zobristKey(uint64_t index)
+{
+    // The key of a feature of the game, computed instead of kept in a table.
+    // The hands are multisets: the key of a card is at the index of the card, and a hand is the sum of the keys of its cards,
+    // so it doesn't depend on their order and every card placed or drawn changes it in O(1).
+    // uint64_t index - The index of the feature, ZOBRIST_STATE and ZOBRIST_ACTION mark the ones that aren't cards.
+    // Return value - The key, the finalizer of SplitMix64 is a bijection so no two indexes share a key.
+
+    return splitMix64(&index);
+}
+
+uint64_t hashHand(Player* player)
+{
+    // Hashing a hand from scratch, after it was dealt or restored.
+    // Return value - The sum of the keys of the cards in the hand.
+
+    uint64_t hash = 0;
+    int i;
+
+    for (i = 0; i < player->handSize; i++)
+        hash += zobristKey(player->deck[i]);
+    return hash;
+}
+
+uint64_t sizeKey(int seat, int handSize)
+{
+    // The key of a player holding a hand of the given size, the keys of the seats are XORed so a card drawn or placed swaps two keys.
+    // int seat - The index of the player.
+    // int handSize - The size of the hand.
+    // Return value - The key.
+
+    return zobristKey(ZOBRIST_SIZE | (uint64_t)seat << 16 | (uint64_t)handSize);
+}
+
+void hashSizes(GameInfo* info, Player* players)
+{
+    // Hashing the sizes of the hands from scratch when a game starts or is restored, drawToHand and placeCard keep it after that.
+    // GameInfo* info - Pointer to the info of the game, its sizeHash is set.
+    // Player* players - Pointer to the array of players.
+
+    int i;
+
+    info->sizeHash = 0;
+    for (i = 0; i < info->numOfPlayers; i++)
+        info->sizeHash ^= sizeKey(i, players[i].handSize);
+}
+
+uint64_t gameHash(GameInfo* info)
+{
+    // The Zobrist hash of the position as the current player sees it: their hand, the sizes of every hand, the top card, the rotation,
+    // the current player, the phase and the TAKI run with its token. The cards of the others are left out, they are exactly
+    // what a searcher doesn't know, but how many they hold is public.
+    // The state besides the hands is a single key, one call no matter what changed.
+
+    return info->players[info->currentlyPlaying].handHash ^ info->sizeHash ^ zobristKey(ZOBRIST_STATE | info->topCard
+        | (uint64_t)info->phase << 8 | (uint64_t)info->takiColour << 12 | (uint64_t)info->rotation << 16
+        | (uint64_t)info->takiToken << 17 | (uint64_t)info->currentlyPlaying << 24);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Options and scripts //////////////////////////////////////////////////
+
+errorCode loadScript(Script* script, const char* path)
+{
+    // Reading a whole script file with one read.
+    // Return value - ERROR_INVALID if the file can't be read, else ERROR_OK.
+
+    FILE* file = fopen(path, "rb");
+    long size;
+
+    if (file == NULL)
+        return ERROR_INVALID;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(file);
+        return ERROR_INVALID;
+    }
+
+    script->data = (char*)malloc((size_t)size + 1);
+    if (script->data == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    script->length = fread(script->data, 1, (size_t)size, file);
+    script->position = 0;
+    fclose(file);
+    return ERROR_OK;
+}
+
+bool nextScriptWord(Script* script, const char** word, size_t* length)
+{
+    // Finding the next word of the script, the words are separated by spaces, tabs and line ends (any character up to ' ').
+    // const char** word - Set to the start of the word, it is not terminated.
+    // size_t* length - Set to the length of the word.
+    // Return value - false when the script has no words left.
+
+    size_t start;
+
+    while (script->position < script->length && (unsigned char)script->data[script->position] <= ' ')
+        script->position++;
+    if (script->position == script->length)
+        return false;
+
+    start = script->position;
+    while (script->position < script->length && (unsigned char)script->data[script->position] > ' ')
+        script->position++;
+    *word = script->data + start;
+    *length = script->position - start;
+    return true;
+}
+
+int readNumber(GameInfo* info)
+{
+    // Reading a number typed by the user, from the script of the game while it has words left, else from stdin.
+    // GameInfo* info - Pointer to the game info.
+    // Return value - The number, -1 for a word of the script that is not a number (an invalid choice), 0 when stdin has no number.
+
+    const char* word;
+    size_t length, i = 0;
+    int value = 0;
+    bool negative = false;
+
+    if (info->script == NULL || !nextScriptWord(info->script, &word, &length)) {
+        scanf("%d", &value);
+        return value;
+    }
+
+    if (word[0] == '-' || word[0] == '+') {
+        negative = word[0] == '-';
+        i++;
+    }
+    if (i == length)
+        return -1;
+    for (; i < length; i++) {
+        if (word[i] < '0' || word[i] > '9' || value > (INT32_MAX - 9) / 10)
+            return -1;
+        value = value * 10 + (word[i] - '0');
+    }
+    return negative ? -value : value;
+}
+
+void readWord(GameInfo* info, char* word, int size)
+{
+    // Reading a word typed by the user, from the script of the game while it has words left, else from stdin.
+    // char* word - Filled with the word, cut to size - 1 characters.
+    // int size - The size of word.
+
+    const char* scripted;
+    size_t length;
+
+    if (info->script == NULL || !nextScriptWord(info->script, &scripted, &length)) {
+        scanf("%s", word);
+        return;
+    }
+    if (length > (size_t)size - 1)
+        length = (size_t)size - 1;
+    memcpy(word, scripted, length);
+    word[length] = '\0';
+}
+
+void initGameOptions(GameOptions* options)
+{
+    // Initializing the options of an interactive game, everything is asked for and every seat is a human.
+
+    memset(options, 0, sizeof(GameOptions));
+    options->cardsPerRow = 1;
+}
+
+int splitList(char* list, char dest[][MAX_NAME])
+{
+    // Splitting a comma separated list, each item is cut to MAX_NAME - 1 characters.
+    // Return value - The amount of items, at most MAX_PLAYERS_LINEUP.
+
+    char* item;
+    int count = 0;
+
+    for (item = strtok(list, ","); item != NULL && count < MAX_PLAYERS_LINEUP; item = strtok(NULL, ",")) {
+        strncpy(dest[count], item, MAX_NAME - 1);
+        dest[count++][MAX_NAME - 1] = '\0';
+    }
+    return count;
+}
+
+errorCode setGameOption(GameOptions* options, const char* key, char* value)
+{
+    // Setting one option, the keys are the names of the command line options without the dashes:
+    //     players <n>, names <a,b,...>, strategies <human | random | greedy | ismcts[:ms[:threads]],...>, seed <n>,
+    //     script <file>, layout <cards> and live <cards>.
+    // Return value - ERROR_INVALID if there is no such option or the value is not valid, else ERROR_OK.
+
+    Strategy* strategy;
+    int i;
+
+    if (strcmp(key, "players") == 0)
+        return (options->numOfPlayers = atoi(value)) >= 1 ? ERROR_OK : ERROR_INVALID;
+    if (strcmp(key, "names") == 0) {
+        options->numOfNames = splitList(value, options->names);
+        return ERROR_OK;
+    }
+    if (strcmp(key, "strategies") == 0) {
+        options->numOfStrategies = splitList(value, options->strategyNames);
+        // Checking the names now, the game doesn't start with a seat it can't fill.
+        for (i = 0; i < options->numOfStrategies; i++) {
+            if (strcmp(options->strategyNames[i], "human") == 0)
+                continue;
+            strategy = newStrategy(options->strategyNames[i], 1, 0);
+            if (strategy == NULL)
+                return ERROR_INVALID;
+            freeStrategy(strategy);
+        }
+        return ERROR_OK;
+    }
+    if (strcmp(key, "seed") == 0) {
+        options->seed = strtoull(value, NULL, 10);
+        options->seeded = true;
+        return ERROR_OK;
+    }
+    if (strcmp(key, "script") == 0) {
+        if (strlen(value) >= sizeof(options->scriptPath))
+            return ERROR_INVALID;
+        strcpy(options->scriptPath, value);
+        return ERROR_OK;
+    }
+    if (strcmp(key, "layout") == 0 || strcmp(key, "live") == 0) {
+        options->live = strcmp(key, "live") == 0;
+        options->cardsPerRow = atoi(value);
+        return options->cardsPerRow >= 1 ? ERROR_OK : ERROR_INVALID;
+    }
+    return ERROR_INVALID;
+}
+
+errorCode loadGameOptions(GameOptions* options, const char* path)
+{
+    // Reading a config file, one option on each line as a key and a value separated by a space, see setGameOption.
+    // An empty line or a line starting with '#' is skipped.
+    // Return value - ERROR_INVALID if the file can't be read or an option is not valid, else ERROR_OK.
+
+    FILE* file = fopen(path, "r");
+    char line[OPTIONS_MAX_LINE];
+    char* key;
+    char* value;
+    int lineNumber = 0;
+
+    if (file == NULL) {
+        printf("Error: Could not open %s !\n", path);
+        return ERROR_INVALID;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        key = strtok(line, " \t\r\n");
+        if (key == NULL || key[0] == '#')
+            continue;
+        value = strtok(NULL, " \t\r\n");
+        if (value == NULL || setGameOption(options, key, value) != ERROR_OK) {
+            printf("Error: Invalid option in %s line %d !\n", path, lineNumber);
+            fclose(file);
+            return ERROR_INVALID;
+        }
+    }
+    fclose(file);
+    return ERROR_OK;
+}
+
+errorCode parseGameOptions(GameOptions* options, int argc, char* argv[])
+{
+    // Parsing the command line of an interactive game, every option is --key value (see setGameOption) or --config <file>.
+    // The cards of --live can be left out. The options are applied in order, so a later one overrides the config file.
+    // Return value - ERROR_INVALID if an option is not valid, else ERROR_OK.
+
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0)
+            return ERROR_INVALID;
+        if (strcmp(argv[i], "--live") == 0 && (i + 1 == argc || argv[i + 1][0] < '0' || argv[i + 1][0] > '9')) {
+            options->live = true;
+            options->cardsPerRow = LIVE_DEFAULT_CARDS;
+        }
+        else if (i + 1 == argc)
+            return ERROR_INVALID;
+        else if (strcmp(argv[i], "--config") == 0) {
+            if (loadGameOptions(options, argv[++i]) != ERROR_OK)
+                return ERROR_INVALID;
+        }
+        else if (setGameOption(options, argv[i] + 2, argv[i + 1]) != ERROR_OK)
+            return ERROR_INVALID;
+        else
+            i++;
+    }
+    return ERROR_OK;
+}
+
+errorCode runInteractiveGame(GameOptions* options, RecordFile* recordTo, Tracer* traceTo)
+{
+    // Playing a game on the screen with the given options.
+    // GameOptions* options - The options of the game, the seed is set to the seed played when none is given.
+    // RecordFile* recordTo - The file the game is recorded to, or NULL.
+    // Tracer* traceTo - The tracer the actions of the game are pushed to, or NULL.
+    // Return value - ERROR_INVALID if the script can't be read, else ERROR_OK.
+
+    Player* players = NULL;
+    GameInfo info = { 0 };
+    Frame screen;
+    LiveScreen live;
+    Recorder recorder;
+    Script script;
+    int i;
+
+    if (options->scriptPath[0] != '\0') {
+        if (loadScript(&script, options->scriptPath) != ERROR_OK) {
+            printf("Error: Could not open %s !\n", options->scriptPath);
+            return ERROR_INVALID;
+        }
+        info.script = &script;
+    }
+    if (!options->seeded)
+        options->seed = (uint64_t)time(NULL);
+    seedGame(&info, options->seed);
+    shuffleDeck(&info);
+
+    initFrame(&screen, options->live ? 1 : options->cardsPerRow);
+    initGlyphCache();
+    info.frame = &screen;
+
+    welcomeMsg();
+
+    if (options->numOfPlayers > 0)
+        info.numOfPlayers = options->numOfPlayers;
+    else
+        setNumOfPlayers(&info, &info.numOfPlayers);
+    if (options->live) {
+        initLiveScreen(&live, info.numOfPlayers, options->cardsPerRow);
+        info.live = &live;
+    }
+    players = (Player*)malloc(sizeof(Player) * info.numOfPlayers);
+    checkPlayerAlloc(players);
+
+    initArena(&info.arena, ARENA_INIT_CAPACITY);
+    initPlayers(&info, players, info.numOfPlayers, options);
+    initGameInfo(&info);
+    if (recordTo != NULL && info.numOfPlayers <= RECORD_MAX_PLAYERS) {
+        initRecorder(&recorder, recordTo);
+        info.recorder = &recorder;
+        recordGameStart(&info, players, options->seed);
+    }
+    info.tracer = traceTo;
+    traceGameStart(&info);
+
+    gameLoop(&info, players);
+    if (info.recorder != NULL)
+        freeRecorder(&recorder);
+    exitGame(&info, players);
+
+    for (i = 0; i < info.numOfPlayers; i++) {
+        if (players[i].strategy != NULL)
+            freeStrategy(players[i].strategy);
+    }
+    if (options->live)
+        freeLiveScreen(&live);
+    if (info.script != NULL)
+        free(script.data);
+    freeFrame(&screen);
+    free(players);
+
+    return ERROR_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Rule sets ////////////////////////////////////////////////////////////////
+
+void defaultRuleSet(RuleSet* rules)
+{
+    // Setting the built-in rules, a rule set file changes them.
+
+    int card, top;
+
+    memcpy(rules->turnRules, defaultTurnRules, sizeof(defaultTurnRules));
+    for (card = 0; card < CARDS_RANGE; card++) {
+        for (top = 0; top < CARDS_RANGE; top++)
+            rules->legal[card][top] = (kindFlags[card] & KIND_FLAG_WILD) != 0;
+        rules->anyRun[card] = (kindFlags[card] & KIND_FLAG_WILD) != 0;
+        rules->copies[card] = (kindFlags[card] & KIND_FLAG_WILD) ? DECK_WILD_COPIES : DECK_COPIES;
+    }
+    rules->dealSize = INIT_QUAN;
+    rules->finiteDeck = false;
+}
+
+int findName(const char* names[], int count, const char* name)
+{
+    // Return value - The index of the name in names, or -1.
+
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+errorCode parseRuleLine(RuleSet* rules, char* line)
+{
+    // Parsing one line of a rule set file into the rule set, the words are separated by spaces:
+    //     deal <cards>                      The amount of cards dealt to each player
+    //     rule <token> [<column> <value>]... The columns of a token: next pick | taki | color, advance 0 - 2, reverse 0 | 1,
+    //                                       lastcard wins | draws | draws2p, inrun continue | endlast | end
+    //     legal <kind> <top kind | any>     A card of the kind can be placed on the top kind whatever their colours
+    //     run <kind>                        A card of the kind can be placed inside a TAKI run of any colour
+    //     deck finite | infinite            Drawing from a shuffled deck, or making every card at random (the default)
+    //     copies <kind> <count>             The copies of the kind in a finite deck, of each colour except for the COLOR card
+    // The tokens are plus, stop, dir, taki, color, reg and draw, the kinds are written as on the cards (1 - 9, +, STOP, <->, TAKI, COLOR).
+    // An empty line or a line starting with '#' is skipped.
+    // RuleSet* rules - The rule set that is changed.
+    // char* line - The line, it is split in place.
+    // Return value - ERROR_INVALID if the line is not understood, else ERROR_OK.
+
+    static const char* phaseNames[] = { "pick", "taki", "color" };
+    static const char* lastCardNames[] = { "wins", "draws", "draws2p" };
+    static const char* inRunNames[] = { "continue", "endlast", "end" };
+    char* words[2 * NUM_OF_TOKENS + 2];
+    char* word;
+    TurnRule* rule;
+    int numOfWords = 0, tokenIndex, card, top, value, i;
+
+    for (word = strtok(line, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n")) {
+        if (numOfWords == (int)(sizeof(words) / sizeof(words[0])))
+            return ERROR_INVALID;
+        words[numOfWords++] = word;
+    }
+    if (numOfWords == 0 || words[0][0] == '#')
+        return ERROR_OK;
+
+    if (strcmp(words[0], "deal") == 0 && numOfWords == 2) {
+        rules->dealSize = atoi(words[1]);
+        return rules->dealSize >= 1 && rules->dealSize <= RULES_MAX_DEAL ? ERROR_OK : ERROR_INVALID;
+    }
+
+    if (strcmp(words[0], "rule") == 0 && numOfWords >= 2 && numOfWords % 2 == 0) {
+        tokenIndex = findName(tokenNames, NUM_OF_TOKENS, words[1]);
+        if (tokenIndex < 0)
+            return ERROR_INVALID;
+        rule = &rules->turnRules[tokenIndex];
+
+        for (i = 2; i < numOfWords; i += 2) {
+            if (strcmp(words[i], "next") == 0 && (value = findName(phaseNames, 3, words[i + 1])) >= 0)
+                rule->nextPhase = (unsigned char)(value == 0 ? PHASE_PICK_CARD : value == 1 ? PHASE_TAKI_PICK : PHASE_PICK_COLOR);
+            else if (strcmp(words[i], "advance") == 0 && (value = atoi(words[i + 1])) >= 0 && value <= RULES_MAX_ADVANCE)
+                rule->advance = (unsigned char)value;
+            else if (strcmp(words[i], "reverse") == 0 && (strcmp(words[i + 1], "0") == 0 || strcmp(words[i + 1], "1") == 0))
+                rule->reverse = words[i + 1][0] == '1';
+            else if (strcmp(words[i], "lastcard") == 0 && (value = findName(lastCardNames, 3, words[i + 1])) >= 0)
+                rule->lastCard = (unsigned char)value;
+            else if (strcmp(words[i], "inrun") == 0 && (value = findName(inRunNames, 3, words[i + 1])) >= 0)
+                rule->inRun = (unsigned char)value;
+            else
+                return ERROR_INVALID;
+        }
+        return ERROR_OK;
+    }
+
+    if (strcmp(words[0], "legal") == 0 && numOfWords == 3) {
+        card = findName(cardTypeStr, CARDS_RANGE, words[1]);
+        top = strcmp(words[2], "any") == 0 ? CARDS_RANGE : findName(cardTypeStr, CARDS_RANGE, words[2]);
+        if (card < 0 || top < 0)
+            return ERROR_INVALID;
+        for (i = 0; i < CARDS_RANGE; i++) {
+            if (top == CARDS_RANGE || top == i)
+                rules->legal[card][i] = true;
+        }
+        return ERROR_OK;
+    }
+
+    if (strcmp(words[0], "deck") == 0 && numOfWords == 2) {
+        if (strcmp(words[1], "finite") != 0 && strcmp(words[1], "infinite") != 0)
+            return ERROR_INVALID;
+        rules->finiteDeck = strcmp(words[1], "finite") == 0;
+        return ERROR_OK;
+    }
+
+    if (strcmp(words[0], "copies") == 0 && numOfWords == 3) {
+        card = findName(cardTypeStr, CARDS_RANGE, words[1]);
+        value = atoi(words[2]);
+        if (card < 0 || value < 0 || value > DECK_MAX_CARDS || (value == 0 && strcmp(words[2], "0") != 0))
+            return ERROR_INVALID;
+        rules->copies[card] = value;
+        return ERROR_OK;
+    }
+
+    if (strcmp(words[0], "run") == 0 && numOfWords == 2) {
+        card = findName(cardTypeStr, CARDS_RANGE, words[1]);
+        if (card < 0)
+            return ERROR_INVALID;
+        rules->anyRun[card] = true;
+        return ERROR_OK;
+    }
+
+    return ERROR_INVALID;
+}
+
+errorCode loadRuleSet(RuleSet* rules, char* path)
+{
+    // Reading a rule set file on top of the rules already in the rule set, see parseRuleLine.
+    // RuleSet* rules - The rule set, usually the built-in rules.
+    // char* path - The path of the file.
+    // Return value - ERROR_INVALID if the file can't be read or a line is not understood, else ERROR_OK.
+
+    FILE* file = fopen(path, "r");
+    char line[RULES_MAX_LINE];
+    int lineNumber = 0, numOfCards = 0, card;
+
+    if (file == NULL) {
+        printf("Error: Could not open %s !\n", path);
+        return ERROR_INVALID;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        if (parseRuleLine(rules, line) != ERROR_OK) {
+            printf("Error: Invalid rule in %s line %d !\n", path, lineNumber);
+            fclose(file);
+            return ERROR_INVALID;
+        }
+    }
+    fclose(file);
+
+    // A draw always passes the turn, a game can't be stuck with a player that only draws.
+    if (rules->turnRules[TOKEN_FROM_DEC - TOKEN_FIRST].nextPhase != PHASE_PICK_CARD) {
+        printf("Error: Drawing a card must pass the turn in %s !\n", path);
+        return ERROR_INVALID;
+    }
+    for (card = 0; card < CARDS_RANGE; card++)
+        numOfCards += rules->copies[card] * ((kindFlags[card] & KIND_FLAG_WILD) ? 1 : COLOR_G);
+    if (rules->finiteDeck && (numOfCards == 0 || numOfCards > DECK_MAX_CARDS)) {
+        printf("Error: A finite deck must have 1 - %d cards in %s !\n", DECK_MAX_CARDS, path);
+        return ERROR_INVALID;
+    }
+    // The first top card is a number card, see shuffleDeck.
+    for (card = 0; card <= KIND_9 && rules->copies[card] == 0; card++)
+        ;
+    if (rules->finiteDeck && card > KIND_9) {
+        printf("Error: A finite deck must have a number card in %s !\n", path);
+        return ERROR_INVALID;
+    }
+    return ERROR_OK;
+}
+
+void compileRuleSet(RuleSet* rules)
+{
+    // Compiling the rule set into the tables read by the game, called once before any game starts.
+
+    int card, top, colour, i;
+
+    memcpy(turnRules, rules->turnRules, sizeof(turnRules));
+    runKinds = 0;
+    memset(runTable, 0, sizeof(runTable));
+    memset(legalTable, 0, sizeof(legalTable));
+    for (top = 0; top < CARDS_RANGE; top++) {
+        legalOn[top] = (unsigned short)(1 << top);
+        for (card = 0; card < CARDS_RANGE; card++) {
+            if (rules->legal[card][top])
+                legalOn[top] |= (unsigned short)(1 << card);
+        }
+        for (card = 0; card < CARDS_RANGE; card++)
+            legalTable[top][card] = (legalOn[top] >> card) & 1 ? 0xFF : 0;
+    }
+    for (card = 0; card < CARDS_RANGE; card++) {
+        if (rules->anyRun[card]) {
+            runKinds |= (unsigned short)(1 << card);
+            runTable[card] = 0xFF;
+        }
+    }
+    dealSize = rules->dealSize;
+
+    // The finite deck in order, every kind in every colour it comes in.
+    numOfDeckCards = 0;
+    for (card = 0; card < CARDS_RANGE && rules->finiteDeck; card++) {
+        for (colour = COLOR_Y; colour <= COLOR_G; colour++) {
+            for (i = 0; i < rules->copies[card]; i++)
+                deckTemplate[numOfDeckCards++] = MAKE_CARD(card, (kindFlags[card] & KIND_FLAG_WILD) ? NO_COLOR : colour);
+            if (kindFlags[card] & KIND_FLAG_WILD)
+                break;
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Legal move masks ///////////////////////////////////////////////////////
+
+bool isLegalCard(GameInfo* info, Card card)
+{
+    // The rules of validateMove for a single card.
+    // GameInfo* info - A pointer to the info of the game, holding the top card and the colour of the TAKI run.
+    // Card card - The card that may be placed.
+    // Return value - true if the card can be placed.
+
+    if (!((legalOn[CARD_KIND(info->topCard)] >> CARD_KIND(card)) & 1) && CARD_COLOR(card) != CARD_COLOR(info->topCard))
+        return false;
+    // While in a TAKI run only the colour of the TAKI can be placed, or a card of runKinds (the COLOR card).
+    return info->takiColour == NO_COLOR || ((runKinds >> CARD_KIND(card)) & 1) || CARD_COLOR(card) == info->takiColour;
+}
+
+uint64_t legalMaskScalar(GameInfo* info, Card* cards, int count)
+{
+    // Return value - A mask with bit i set when cards[i] can be placed, count must be at most MASK_CARDS.
+
+    uint64_t mask = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (isLegalCard(info, cards[i]))
+            mask |= (uint64_t)1 << i;
+    }
+    return mask;
+}
+
+uint64_t legalMask(GameInfo* info, Card* cards, int count)
+{
+    // Finding every card that can be placed in one pass, comparing the packed kinds and colours of a whole vector of cards
+    // with the top card at once. The cards left over after the last full vector are checked one by one.
+    // With AVX2 the kinds that can be placed are looked up in the row of legalTable with a shuffle, with SSE2 the kinds
+    // are compared with each kind of legalOn (the top kind and the COLOR card with the built-in rules).
+    // GameInfo* info - A pointer to the info of the game.
+    // Card* cards - The cards, usually the deck of a player from some offset.
+    // int count - The amount of cards, at most MASK_CARDS.
+    // Return value - A mask with bit i set when cards[i] can be placed.
+
+    uint64_t mask = 0;
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i kindMask = _mm256_set1_epi8(CARD_KIND_MASK);
+    __m256i colourMask = _mm256_set1_epi8((char)~CARD_KIND_MASK);
+    __m256i legalKinds = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)legalTable[CARD_KIND(info->topCard)]));
+    __m256i runAny = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)runTable));
+    __m256i topColour = _mm256_set1_epi8((char)(info->topCard & ~CARD_KIND_MASK));
+    __m256i takiColour = _mm256_set1_epi8((char)(info->takiColour << CARD_COLOR_SHIFT));
+    __m256i v, kinds, colours, legal;
+
+    for (; i + 32 <= count; i += 32) {
+        v = _mm256_loadu_si256((const __m256i*)(cards + i));
+        kinds = _mm256_and_si256(v, kindMask);
+        colours = _mm256_and_si256(v, colourMask);
+        legal = _mm256_or_si256(_mm256_shuffle_epi8(legalKinds, kinds), _mm256_cmpeq_epi8(colours, topColour));
+        if (info->takiColour != NO_COLOR)
+            legal = _mm256_and_si256(legal, _mm256_or_si256(_mm256_shuffle_epi8(runAny, kinds), _mm256_cmpeq_epi8(colours, takiColour)));
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(legal) << i;
+    }
+#elif defined(TAKI_SSE2)
+    __m128i kindMask = _mm_set1_epi8(CARD_KIND_MASK);
+    __m128i colourMask = _mm_set1_epi8((char)~CARD_KIND_MASK);
+    __m128i topColour = _mm_set1_epi8((char)(info->topCard & ~CARD_KIND_MASK));
+    __m128i takiColour = _mm_set1_epi8((char)(info->takiColour << CARD_COLOR_SHIFT));
+    __m128i v, kinds, colours, legal, inRun;
+    unsigned short bits;
+
+    for (; i + 16 <= count; i += 16) {
+        v = _mm_loadu_si128((const __m128i*)(cards + i));
+        kinds = _mm_and_si128(v, kindMask);
+        colours = _mm_and_si128(v, colourMask);
+        legal = _mm_cmpeq_epi8(colours, topColour);
+        for (bits = legalOn[CARD_KIND(info->topCard)]; bits != 0; bits &= bits - 1)
+            legal = _mm_or_si128(legal, _mm_cmpeq_epi8(kinds, _mm_set1_epi8((char)lowestBit(bits))));
+        if (info->takiColour != NO_COLOR) {
+            inRun = _mm_cmpeq_epi8(colours, takiColour);
+            for (bits = runKinds; bits != 0; bits &= bits - 1)
+                inRun = _mm_or_si128(inRun, _mm_cmpeq_epi8(kinds, _mm_set1_epi8((char)lowestBit(bits))));
+            legal = _mm_and_si128(legal, inRun);
+        }
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(legal) << i;
+    }
+#endif
+
+    if (i < count)
+        mask |= legalMaskScalar(info, cards + i, count - i) << i;
+
+    return mask;
+}
+
+int countBits(uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(mask);
+#else
+    int count = 0;
+
+    for (; mask != 0; mask &= mask - 1)
+        count++;
+    return count;
+#endif
+}
+
+int lowestBit(uint64_t mask)
+{
+    // Return value - The index of the lowest set bit, the mask must not be 0.
+
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int i = 0;
+
+    for (; (mask & 1) == 0; mask >>= 1)
+        i++;
+    return i;
+#endif
+}
+
+int highestBit(uint64_t mask)
+{
+    // Return value - The index of the highest set bit, the mask must not be 0.
+
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(mask);
+#else
+    int i = 0;
+
+    for (; mask > 1; mask >>= 1)
+        i++;
+    return i;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Hand counts ///////////////////////////////////////////////////////////
+
+void countHands(GameInfo* info, Player* players)
+{
+    // Counting the decks of every player from scratch, when a game starts or is restored.
+    // GameInfo* info - Pointer to the info of the game.
+    // Player* players - Pointer to the array of players, their counts are set.
+
+    int i;
+
+    for (i = 0; i < info->numOfPlayers; i++) {
+        players[i].counts = NULL;
+        if (players[i].handSize > MASK_CARDS)
+            countHand(&info->arena, &players[i]);
+    }
+}
+
+void countHand(HandArena* arena, Player* player)
+{
+    // Counting the deck of a player that got longer than MASK_CARDS, drawToHand keeps the counts from then on.
+    // The counts are taken from the arena of the game, so they are gone with the decks when it is reset.
+    // HandArena* arena - Pointer to the arena of the game.
+    // Player* player - Pointer to the player, its counts are set.
+
+    Card* block = arenaAlloc(arena, sizeof(HandCounts) + _Alignof(HandCounts) - 1);
+    int i;
+
+    player->counts = (HandCounts*)(block + (-(uintptr_t)block & (_Alignof(HandCounts) - 1)));
+    memset(player->counts, 0, sizeof(HandCounts));
+    for (i = 0; i < player->handSize; i++)
+        addToCounts(player->counts, player->deck[i]);
+}
+
+void addToCounts(HandCounts* counts, Card card)
+{
+    counts->cell[CARD_KIND(card)][CARD_COLOR(card)]++;
+    counts->kind[CARD_KIND(card)]++;
+    counts->colour[CARD_COLOR(card)]++;
+}
+
+void removeFromCounts(HandCounts* counts, Card card)
+{
+    counts->cell[CARD_KIND(card)][CARD_COLOR(card)]--;
+    counts->kind[CARD_KIND(card)]--;
+    counts->colour[CARD_COLOR(card)]--;
+}
+
+int countLegalCards(GameInfo* info, HandCounts* counts)
+{
+    // Counting the cards of a hand that can be placed, the rules of isLegalCard applied to a kind at a time.
+    // GameInfo* info - A pointer to the info of the game, holding the top card and the colour of the TAKI run.
+    // HandCounts* counts - The counts of the hand.
+    // Return value - The amount of cards that can be placed, the same as the bits of legalMask over the deck.
+
+    unsigned short legalKinds = legalOn[CARD_KIND(info->topCard)];
+    int topColour = CARD_COLOR(info->topCard), kind, total = 0;
+    bool anyColour;
+
+    for (kind = 0; kind < CARDS_RANGE; kind++) {
+        // Outside of a TAKI run, or for a kind of runKinds, the colour of the run doesn't matter.
+        anyColour = info->takiColour == NO_COLOR || ((runKinds >> kind) & 1);
+        if ((legalKinds >> kind) & 1)
+            total += anyColour ? counts->kind[kind] : counts->cell[kind][info->takiColour];
+        else if (anyColour || topColour == info->takiColour)
+            total += counts->cell[kind][topColour];
+    }
+    return total;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Strategies and headless simulation ////////////////////////////////////
+
+Strategy randomStrategy = { randomPickCard, randomPickColor, NULL };
+Strategy greedyStrategy = { greedyPickCard, greedyPickColor, NULL };
+
+int randomPickCard(GameInfo* info, Player* player, void* context)
+{
+    // Strategy choosing a random valid card, drawing a card only when there is no valid card.
+    // Return value - 0 for drawing a card or 1 - handSize.
+
+    uint64_t mask;
+    int base, count, validCount = 0, chosen;
+
+    (void)context;
+    if (player->counts != NULL && player->handSize > MASK_CARDS)
+        validCount = countLegalCards(info, player->counts);
+    else {
+        for (base = 0; base < player->handSize; base += MASK_CARDS) {
+            count = player->handSize - base < MASK_CARDS ? player->handSize - base : MASK_CARDS;
+            validCount += countBits(legalMask(info, player->deck + base, count));
+        }
+    }
+    if (validCount == 0)
+        return 0;
+
+    chosen = getRandInRange(&info->botRng, validCount);
+    for (base = 0; ; base += MASK_CARDS) {
+        count = player->handSize - base < MASK_CARDS ? player->handSize - base : MASK_CARDS;
+        mask = legalMask(info, player->deck + base, count);
+        if (chosen > countBits(mask)) {
+            chosen -= countBits(mask);
+            continue;
+        }
+        // Clearing the valid cards before the chosen one.
+        while (--chosen > 0)
+            mask &= mask - 1;
+        return base + lowestBit(mask) + 1;
+    }
+}
+
+int randomPickColor(GameInfo* info, Player* player, void* context)
+{
+    // Strategy choosing a random colour.
+    // Return value - COLOR_Y - COLOR_G
+
+    (void)player;
+    (void)context;
+    return getRandInRange(&info->botRng, COLOR_G);
+}
+
+int greedyPickCard(GameInfo* info, Player* player, void* context)
+{
+    // Strategy placing the first valid card, a COLOR card is kept for when nothing else can be placed.
+    // Return value - 0 for drawing a card or 1 - handSize.
+
+    uint64_t mask;
+    int base, count, i, colorCard = 0;
+
+    (void)context;
+    // Nothing to look for when no card can be placed, asked only when the hand is longer than a mask.
+    if (player->counts != NULL && player->handSize > MASK_CARDS && countLegalCards(info, player->counts) == 0)
+        return 0;
+
+    for (base = 0; base < player->handSize; base += MASK_CARDS) {
+        count = player->handSize - base < MASK_CARDS ? player->handSize - base : MASK_CARDS;
+        for (mask = legalMask(info, player->deck + base, count); mask != 0; mask &= mask - 1) {
+            i = base + lowestBit(mask);
+            if (!(kindFlags[CARD_KIND(player->deck[i])] & KIND_FLAG_WILD))
+                return i + 1;
+            colorCard = i + 1;
+        }
+    }
+    return colorCard;
+}
+
+int greedyPickColor(GameInfo* info, Player* player, void* context)
+{
+    // Strategy choosing the colour that appears the most in the hand of the player.
+    // Return value - COLOR_Y - COLOR_G
+
+    int counts[COLOR_G + 1] = { 0 };
+    int i, best = COLOR_Y;
+
+    (void)info;
+    (void)context;
+    if (player->counts != NULL) {
+        for (i = COLOR_Y; i <= COLOR_G; i++)
+            counts[i] = player->counts->colour[i];
+    }
+    else {
+        for (i = 0; i < player->handSize; i++)
+            counts[CARD_COLOR(player->deck[i])]++;
+    }
+    for (i = COLOR_R; i <= COLOR_G; i++) {
+        if (counts[i] > counts[best])
+            best = i;
+    }
+    return best;
+}
+
+Strategy* newStrategy(char* name, int searchThreads, uint64_t seed)
+{
+    // Creating an instance of the strategy with the given name, every instance has its own state.
+    // char* name - "random", "greedy" or "ismcts[:milliseconds[:threads]]".
+    // int searchThreads - The amount of search threads of an ISMCTS player when the name doesn't give one.
+    // uint64_t seed - Seeds the playouts of an ISMCTS player.
+    // Return value - The new strategy, released with freeStrategy, or NULL if there is no such strategy.
+
+    Strategy* strategy = (Strategy*)malloc(sizeof(Strategy));
+    int milliseconds = ISMCTS_DEFAULT_MS, threads = searchThreads;
+
+    if (strategy == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+
+    if (strcmp(name, "random") == 0)
+        *strategy = randomStrategy;
+    else if (strcmp(name, "greedy") == 0)
+        *strategy = greedyStrategy;
+    else if (strncmp(name, "ismcts", 6) == 0 && (name[6] == '\0' || name[6] == ':')) {
+        if (name[6] == ':')
+            sscanf(name + 7, "%d:%d", &milliseconds, &threads);
+        if (milliseconds < 1 || threads < 1 || threads > MAX_THREADS) {
+            free(strategy);
+            return NULL;
+        }
+        strategy->pickCard = ismctsPickCard;
+        strategy->pickColor = ismctsPickColor;
+        strategy->context = newIsmctsBot(milliseconds / 1000.0, threads, seed);
+    }
+    else {
+        free(strategy);
+        return NULL;
+    }
+    return strategy;
+}
+
+void freeStrategy(Strategy* strategy)
+{
+    if (strategy->pickCard == ismctsPickCard)
+        freeIsmctsBot((IsmctsBot*)strategy->context);
+    free(strategy);
+}
+
+void printStrategyReport(char* name, Strategy** instances, int numOfInstances)
+{
+    // Printing the search statistics of the instances of a strategy, only the ISMCTS player has any.
+    // char* name - The name of the strategy.
+    // Strategy** instances - The instances of the strategy, their statistics are summed.
+    // int numOfInstances - The amount of instances.
+
+    IsmctsBot* bot;
+    long long moves = 0, playouts = 0, tableHits = 0;
+    double seconds = 0;
+    int i;
+
+    for (i = 0; i < numOfInstances; i++) {
+        if (instances[i]->pickCard != ismctsPickCard)
+            return;
+        bot = (IsmctsBot*)instances[i]->context;
+        moves += bot->moves;
+        playouts += bot->playouts;
+        tableHits += bot->tableHits;
+        seconds += bot->seconds;
+    }
+    if (moves == 0)
+        return;
+
+    printf("%s searched %lld moves, %lld playouts in %.2f seconds (%.0f playouts/sec, %.0f playouts/move, %lld table hits)\n",
+        name, moves, playouts, seconds, seconds > 0 ? playouts / seconds : 0.0, (double)playouts / moves, tableHits);
+}
+
+void initBotPlayers(Player* players, int numOfPlayers, Strategy* strategy)
+{
+    // Initializing players that are played by a strategy, the names are "Bot #1", "Bot #2" etc.
+    // Player* players - An array of players.
+    // int numOfPlayers - The amount of players that needs to be initialized.
+    // Strategy* strategy - The strategy of every player.
+
+    char name[MAX_NAME];
+    int i;
+
+    for (i = 0; i < numOfPlayers; i++) {
+        sprintf(name, "%s #%d", BOT_NAME, i + 1);
+        players[i].name = internName(name);
+        players[i].strategy = strategy;
+
+        // The decks are allocated for each game by dealHand.
+        players[i].deck = NULL;
+        players[i].handCapacity = 0;
+        players[i].handSize = 0;
+        players[i].handHash = 0;
+        players[i].counts = NULL;
+    }
+}
+
+int playHeadlessGame(GameInfo* info, Player* players, uint64_t seed)
+{
+    // Playing one complete game without printing anything, the arena of the previous game is reused.
+    // GameInfo* info - Pointer to the info of the game, the histogram keeps counting across games.
+    // Player* players - Pointer to the array of players, each of them must have a strategy.
+    // uint64_t seed - The seed of the game, the same seed and strategies always play the same game.
+    // Return value - The index of the winner, or NO_WINNER.
+
+    int i, winner;
+
+    seedGame(info, seed);
+    resetArena(&info->arena);
+    shuffleDeck(info);
+    for (i = 0; i < info->numOfPlayers; i++)
+        dealHand(info, &players[i]);
+    dealTopCard(info);
+    info->currentlyPlaying = FIRST_PLAYER;
+    info->rotation = true;
+    info->phase = PHASE_PICK_CARD;
+    info->takiColour = NO_COLOR;
+    recordGameStart(info, players, seed);
+    traceGameStart(info);
+
+    winner = gameLoop(info, players);
+    if (info->stats != NULL)
+        endStatsGame(info->stats, players, winner);
+    if (info->recorder != NULL && !info->recorder->replay && info->recorder->length >= RECORD_BLOCK)
+        flushRecorder(info->recorder);
+    return winner;
+}
+
+errorCode runSimulation(int numOfGames, int numOfPlayers, char* strategyName, uint64_t seed, RecordFile* record, Tracer* tracer, const char* statsPath)
+{
+    // Simulating games between bots and printing the results once all the games are over.
+    // int numOfGames - The amount of games to play.
+    // int numOfPlayers - The amount of players in each game.
+    // char* strategyName - The name of the strategy of every player, an ISMCTS player searches on every core.
+    // uint64_t seed - Game number i is played with the seed + i.
+    // RecordFile* record - The file the games are recorded to, or NULL.
+    // Tracer* tracer - The tracer the actions of the games are pushed to, or NULL.
+    // const char* statsPath - The file the statistics of the games are written to, or NULL.
+    // Return value - ERROR_INVALID if there is no such strategy, else ERROR_OK.
+
+    Strategy* strategy = newStrategy(strategyName, getCoreCount(), seed);
+    Player* players = NULL;
+    GameInfo info = { 0 };
+    Recorder recorder;
+    GameStats stats;
+    int* wins = NULL;
+    int i, winner;
+    double start, seconds;
+
+    if (strategy == NULL)
+        return ERROR_INVALID;
+
+    players = (Player*)malloc(sizeof(Player) * numOfPlayers);
+    checkPlayerAlloc(players);
+    wins = (int*)calloc(numOfPlayers, sizeof(int));
+    if (wins == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+
+    info.numOfPlayers = numOfPlayers;
+    info.headless = true;
+    initHistogram(&info.histogram);
+    initArena(&info.arena, ARENA_INIT_CAPACITY);
+    initBotPlayers(players, numOfPlayers, strategy);
+    if (record != NULL) {
+        initRecorder(&recorder, record);
+        info.recorder = &recorder;
+    }
+    info.tracer = tracer;
+    if (statsPath != NULL) {
+        initGameStats(&stats, numOfPlayers);
+        info.stats = &stats;
+    }
+
+    start = wallSeconds();
+    for (i = 0; i < numOfGames; i++) {
+        winner = playHeadlessGame(&info, players, seed + i);
+        if (winner != NO_WINNER)
+            wins[winner]++;
+    }
+    seconds = wallSeconds() - start;
+
+    printf("Simulated %d games of %d players in %.2f seconds (%.0f games/sec), seed %llu\n",
+        numOfGames, numOfPlayers, seconds, seconds > 0 ? numOfGames / seconds : 0.0, (unsigned long long)seed);
+    for (i = 0; i < numOfPlayers; i++)
+        printf("%s won %d games\n", players[i].name, wins[i]);
+    printStrategyReport(strategyName, &strategy, 1);
+    if (statsPath != NULL) {
+        writeGameStats(&stats, statsPath);
+        freeGameStats(&stats);
+    }
+
+    if (record != NULL)
+        freeRecorder(&recorder);
+    exitGame(&info, players);
+    freeStrategy(strategy);
+    free(wins);
+    free(players);
+
+    return ERROR_OK;
+}
+
+errorCode runLargeTable(int numOfSeats, int numOfGames, char* strategyName, uint64_t seed, const char* statsPath)
+{
+    // Playing games between bots at a table with many seats and printing the memory each seat takes.
+    // int numOfSeats - The amount of players at the table.
+    // int numOfGames - The amount of games to play.
+    // char* strategyName - The name of the strategy of every player.
+    // uint64_t seed - Game number i is played with the seed + i.
+    // const char* statsPath - The file the statistics of the games are written to, or NULL.
+    // Return value - ERROR_INVALID if there is no such strategy, else ERROR_OK.
+
+    Strategy* strategy = newStrategy(strategyName, getCoreCount(), seed);
+    Player* players = NULL;
+    GameInfo info = { 0 };
+    GameStats stats;
+    int* wins = NULL;
+    int i, winner, best = 0;
+    size_t handBytes, nameBytes;
+    double start, seconds;
+
+    if (strategy == NULL)
+        return ERROR_INVALID;
+
+    players = (Player*)malloc(sizeof(Player) * numOfSeats);
+    checkPlayerAlloc(players);
+    wins = (int*)calloc(numOfSeats, sizeof(int));
+    if (wins == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+
+    info.numOfPlayers = numOfSeats;
+    info.headless = true;
+    initHistogram(&info.histogram);
+    initArena(&info.arena, ARENA_INIT_CAPACITY);
+    initBotPlayers(players, numOfSeats, strategy);
+    if (statsPath != NULL) {
+        initGameStats(&stats, numOfSeats);
+        info.stats = &stats;
+    }
+
+    start = wallSeconds();
+    for (i = 0; i < numOfGames; i++) {
+        winner = playHeadlessGame(&info, players, seed + i);
+        if (winner != NO_WINNER)
+            wins[winner]++;
+    }
+    seconds = wallSeconds() - start;
+
+    for (i = 1; i < numOfSeats; i++) {
+        if (wins[i] > wins[best])
+            best = i;
+    }
+
+    // The hands are measured by the arena of the last game, which holds their counts too, the names by the pool they are shared from.
+    handBytes = (info.arena.capacity + info.arena.overflowCards) * sizeof(Card);
+    mtx_lock(&namePool.lock);
+    nameBytes = namePool.bytes;
+    mtx_unlock(&namePool.lock);
+
+    printf("Played %d games of %d seats in %.2f seconds (%.0f games/sec), seed %llu\n",
+        numOfGames, numOfSeats, seconds, seconds > 0 ? numOfGames / seconds : 0.0, (unsigned long long)seed);
+    printf("%s won the most games, %d\n", players[best].name, wins[best]);
+    printf("Memory per seat: %.1f bytes (player %zu, hand %.1f, name %.1f)\n",
+        (double)(sizeof(Player) * numOfSeats + handBytes + nameBytes) / numOfSeats, sizeof(Player),
+        (double)handBytes / numOfSeats, (double)nameBytes / numOfSeats);
+    if (statsPath != NULL) {
+        writeGameStats(&stats, statsPath);
+        freeGameStats(&stats);
+    }
+
+    exitGame(&info, players);
+    freeStrategy(strategy);
+    free(wins);
+    free(players);
+
+    return ERROR_OK;
+}
+
+///////////////////////////////// Lockstep batches ////////////////////////////////////////////////////
+
+Batch* newBatch(int numOfLanes, int numOfPlayers, Strategy* strategy, long long numOfGames, uint64_t seed)
+{
+    // Creating a batch and dealing the first game of every lane.
+    // int numOfLanes - The amount of games advanced together, at most BATCH_MAX_LANES.
+    // int numOfPlayers - The amount of players of every game, at most BATCH_MAX_PLAYERS.
+    // Strategy* strategy - The strategy of every player.
+    // long long numOfGames - The amount of games in the queue.
+    // uint64_t seed - The seed of the first game.
+    // Return value - The batch, released with freeBatch.
+
+    Batch* batch = (Batch*)calloc(1, sizeof(Batch));
+    int lane, i;
+
+    if (batch == NULL || (batch->wins = (long long*)calloc(numOfPlayers, sizeof(long long))) == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+
+    batch->numOfLanes = (numOfLanes + BATCH_GROUP - 1) / BATCH_GROUP * BATCH_GROUP;
+    batch->numOfPlayers = numOfPlayers;
+    batch->strategy = strategy;
+    batch->numOfGames = numOfGames;
+    batch->seed = seed;
+    initHistogram(&batch->histogram);
+    batch->view.numOfPlayers = numOfPlayers;
+    batch->view.headless = true;
+    batch->viewPlayer.strategy = strategy;
+
+    for (i = 0; i < numOfPlayers; i++) {
+        for (lane = 0; lane < batch->numOfLanes; lane++) {
+            batch->handCapacity[i][lane] = (unsigned short)dealSize;
+            batch->hands[i][lane] = (Card*)malloc(dealSize);
+            checkCardAlloc(batch->hands[i][lane]);
+        }
+    }
+    for (lane = 0; lane < numOfLanes; lane++)
+        refillLane(batch, lane);
+
+    return batch;
+}
+
+void freeBatch(Batch* batch)
+{
+    int lane, i;
+
+    for (i = 0; i < batch->numOfPlayers; i++) {
+        for (lane = 0; lane < batch->numOfLanes; lane++)
+            free(batch->hands[i][lane]);
+    }
+    free(batch->wins);
+    free(batch);
+}
+
+void loadLaneRng(uint64_t state[4][BATCH_MAX_LANES], int lane, Rng* rng)
+{
+    // Copying the generator of a lane out of the parallel arrays, storeLaneRng copies it back.
+
+    int i;
+
+    for (i = 0; i < 4; i++)
+        rng->s[i] = state[i][lane];
+}
+
+void storeLaneRng(uint64_t state[4][BATCH_MAX_LANES], int lane, Rng* rng)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        state[i][lane] = rng->s[i];
+}
+
+void refillLane(Batch* batch, int lane)
+{
+    // Dealing the next game of the queue in the lane, exactly as playHeadlessGame deals it, or stopping the lane if the queue is empty.
+
+    GameInfo dealer = { 0 };
+    int i, j;
+
+    if (batch->nextGame == batch->numOfGames) {
+        batch->active[lane] = 0;
+        return;
+    }
+
+    dealer.deckKinds = batch->deckKinds;
+    dealer.numOfDeckKinds = batch->numOfDeckKinds;
+    seedGame(&dealer, batch->seed + batch->nextGame++);
+    for (i = 0; i < batch->numOfPlayers; i++) {
+        for (j = 0; j < dealSize; j++)
+            drawCard(&dealer, &batch->hands[i][lane][j]);
+        batch->handSize[i][lane] = (unsigned short)dealSize;
+    }
+    initTopCard(&dealer.rng, &batch->topCard[lane], getRandInRange(&dealer.rng, 9));
+    storeLaneRng(batch->rng, lane, &dealer.rng);
+    storeLaneRng(batch->botRng, lane, &dealer.botRng);
+
+    batch->active[lane] = 1;
+    batch->currentlyPlaying[lane] = FIRST_PLAYER;
+    batch->direction[lane] = 1;
+    batch->phase[lane] = PHASE_PICK_CARD;
+    batch->takiColour[lane] = NO_COLOR;
+    batch->takiToken[lane] = TOKEN_FROM_DEC;
+}
+
+void decideLane(Batch* batch, int lane)
+{
+    // The part of a round that differs between the games, the strategy of the current player makes its decision
+    // and a card is placed. The rule the turn ends with is looked up in turnRules, as step would apply it,
+    // and left for applyBatchRules.
+
+    GameInfo* view = &batch->view;
+    Player* player = &batch->viewPlayer;
+    const TurnRule* rule;
+    int choice, cur = batch->currentlyPlaying[lane];
+    token tokenType, ruleToken;
+
+    view->topCard = batch->topCard[lane];
+    view->takiColour = batch->takiColour[lane];
+    view->phase = batch->phase[lane];
+    loadLaneRng(batch->botRng, lane, &view->botRng);
+    player->deck = batch->hands[cur][lane];
+    player->handSize = batch->handSize[cur][lane];
+    batch->mover[lane] = (unsigned char)cur;
+
+    if (view->phase == PHASE_PICK_COLOR) {
+        choice = batch->strategy->pickColor(view, player, batch->strategy->context);
+        if (choice >= COLOR_Y && choice <= COLOR_G)
+            batch->topCard[lane] = MAKE_CARD(CARD_KIND(view->topCard), choice);
+        // The turn passes as after a regular card.
+        ruleToken = TOKEN_REG;
+    }
+    else {
+        choice = batch->strategy->pickCard(view, player, batch->strategy->context);
+        if (validateMove(view, player, choice) != ERROR_OK)
+            choice = 0;
+
+        if (choice == 0) {
+            batch->needDraw[lane] = 1;
+            tokenType = TOKEN_FROM_DEC;
+        }
+        else {
+            batch->topCard[lane] = player->deck[choice - 1];
+            swapCards(&player->deck[choice - 1], &player->deck[--batch->handSize[cur][lane]]);
+            tokenType = mapTopType(batch->topCard[lane]);
+        }
+
+        ruleToken = tokenType;
+        if (view->phase == PHASE_TAKI_PICK) {
+            // Inside a TAKI run, as in step.
+            switch (turnRules[tokenType - TOKEN_FIRST].inRun) {
+            case RUN_CONTINUE:
+                batch->takiToken[lane] = (unsigned char)tokenType;
+                ruleToken = batch->handSize[cur][lane] == 0 ? tokenType : NO_TOKEN;
+                break;
+            case RUN_END_LAST:
+                ruleToken = batch->takiToken[lane];
+                break;
+            }
+            if (ruleToken != NO_TOKEN)
+                batch->takiColour[lane] = NO_COLOR;
+        }
+    }
+    storeLaneRng(batch->botRng, lane, &view->botRng);
+
+    if (ruleToken == NO_TOKEN)
+        return;
+    rule = &turnRules[ruleToken - TOKEN_FIRST];
+    batch->apply[lane] = 1;
+    batch->empty[lane] = batch->handSize[cur][lane] == 0;
+    batch->advance[lane] = rule->advance;
+    batch->reverse[lane] = rule->reverse;
+    batch->nextPhase[lane] = rule->nextPhase;
+    batch->lastCard[lane] = rule->lastCard;
+}
+
+#if defined(__AVX2__) || defined(TAKI_SSE2)
+// Loading and storing the bytes of a group of lanes, and choosing between the bytes of a and b by a mask of 0x00 / 0xFF bytes.
+#define LOAD_LANES(array, lane)			_mm_loadu_si128((const __m128i*)((array) + (lane)))
+#define STORE_LANES(array, lane, v)		_mm_storeu_si128((__m128i*)((array) + (lane)), (v))
+#define SELECT_BYTES(mask, a, b)		_mm_or_si128(_mm_and_si128((mask), (a)), _mm_andnot_si128((mask), (b)))
+#endif
+
+void applyBatchRules(Batch* batch)
+{
+    // Applying the turn rules of the round in every lane at once, the same rules as applyTurnRule.
+    // A lane with no rule to apply is left as it is.
+    // A card drawn in the round can't change the rules, the hand is not empty either way, so the card is drawn afterwards.
+    // With SSE2 a whole group of lanes is one vector of bytes, every flag turned into a mask of 0x00 / 0xFF.
+
+    int numOfLanes = batch->numOfLanes, numOfPlayers = batch->numOfPlayers, lane;
+    unsigned char headsUp = numOfPlayers == 2 ? LAST_CARD_DRAWS_2P : LAST_CARD_DRAWS; // The rule that draws in this game too
+
+#if defined(__AVX2__) || defined(TAKI_SSE2)
+    __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi8(1);
+    __m128i players = _mm_set1_epi8((char)numOfPlayers), lastSeat = _mm_set1_epi8((char)(numOfPlayers - 1));
+    __m128i alone = _mm_set1_epi8(numOfPlayers == 1 ? (char)0xFF : 0); // A single player never leaves the seat
+    __m128i apply, empty, lastDraw, over, turn, reverse, run, direction, negative, steps, seat, phase;
+
+    for (lane = 0; lane < numOfLanes; lane += BATCH_GROUP) {
+        apply = _mm_sub_epi8(zero, LOAD_LANES(batch->apply, lane));
+        empty = _mm_sub_epi8(zero, LOAD_LANES(batch->empty, lane));
+        lastDraw = _mm_and_si128(empty, _mm_or_si128(_mm_cmpeq_epi8(LOAD_LANES(batch->lastCard, lane), _mm_set1_epi8(LAST_CARD_DRAWS)),
+            _mm_cmpeq_epi8(LOAD_LANES(batch->lastCard, lane), _mm_set1_epi8((char)headsUp))));
+        lastDraw = _mm_and_si128(apply, lastDraw);
+        over = _mm_andnot_si128(lastDraw, _mm_and_si128(apply, empty));
+        turn = _mm_andnot_si128(empty, apply);
+        reverse = _mm_and_si128(turn, _mm_sub_epi8(zero, LOAD_LANES(batch->reverse, lane)));
+        run = _mm_and_si128(turn, _mm_cmpeq_epi8(LOAD_LANES(batch->nextPhase, lane), _mm_set1_epi8(PHASE_TAKI_PICK)));
+
+        STORE_LANES(batch->needDraw, lane, _mm_or_si128(LOAD_LANES(batch->needDraw, lane), _mm_and_si128(lastDraw, one)));
+
+        // Negating the direction where it's reversed, and moving the seat by steps in the direction.
+        direction = _mm_sub_epi8(_mm_xor_si128(LOAD_LANES(batch->direction, lane), reverse), reverse);
+        STORE_LANES(batch->direction, lane, direction);
+        steps = _mm_or_si128(_mm_and_si128(turn, LOAD_LANES(batch->advance, lane)), _mm_and_si128(lastDraw, one));
+        negative = _mm_cmpgt_epi8(zero, direction);
+        seat = _mm_add_epi8(LOAD_LANES(batch->currentlyPlaying, lane), _mm_sub_epi8(_mm_xor_si128(steps, negative), negative));
+        seat = _mm_add_epi8(seat, _mm_and_si128(_mm_cmpgt_epi8(zero, seat), players));
+        seat = _mm_sub_epi8(seat, _mm_and_si128(_mm_cmpgt_epi8(seat, lastSeat), players));
+        STORE_LANES(batch->currentlyPlaying, lane, _mm_andnot_si128(alone, seat));
+
+        STORE_LANES(batch->takiColour, lane, SELECT_BYTES(run,
+            _mm_and_si128(_mm_srli_epi16(LOAD_LANES(batch->topCard, lane), CARD_COLOR_SHIFT), _mm_set1_epi8(0x0F)),
+            LOAD_LANES(batch->takiColour, lane)));
+        STORE_LANES(batch->takiToken, lane, SELECT_BYTES(run, _mm_set1_epi8(TOKEN_FROM_DEC), LOAD_LANES(batch->takiToken, lane)));
+        phase = SELECT_BYTES(over, _mm_set1_epi8(PHASE_GAME_OVER),
+            SELECT_BYTES(lastDraw, _mm_set1_epi8(PHASE_PICK_CARD), LOAD_LANES(batch->nextPhase, lane)));
+        STORE_LANES(batch->phase, lane, SELECT_BYTES(apply, phase, LOAD_LANES(batch->phase, lane)));
+    }
+#else
+    unsigned char apply, empty, lastDraw, over, reverse, run, steps;
+    signed char seat;
+
+    for (lane = 0; lane < numOfLanes; lane++) {
+        apply = batch->apply[lane];
+        empty = batch->empty[lane];
+        lastDraw = apply & empty & ((batch->lastCard[lane] == LAST_CARD_DRAWS) | (batch->lastCard[lane] == headsUp));
+        over = apply & empty & !lastDraw;
+        reverse = apply & !empty & batch->reverse[lane];
+        run = apply & !empty & (batch->nextPhase[lane] == PHASE_TAKI_PICK);
+
+        batch->needDraw[lane] |= lastDraw;
+        batch->direction[lane] = reverse ? -batch->direction[lane] : batch->direction[lane];
+
+        // The seat moves at most two steps, and a game has at least two players for a step to matter.
+        steps = apply ? (empty ? lastDraw : batch->advance[lane]) : 0;
+        seat = (signed char)(batch->currentlyPlaying[lane] + batch->direction[lane] * steps);
+        seat = seat < 0 ? seat + numOfPlayers : seat;
+        seat = seat >= numOfPlayers ? seat - numOfPlayers : seat;
+        batch->currentlyPlaying[lane] = numOfPlayers == 1 ? 0 : (unsigned char)seat;
+
+        batch->takiColour[lane] = run ? CARD_COLOR(batch->topCard[lane]) : batch->takiColour[lane];
+        batch->takiToken[lane] = run ? TOKEN_FROM_DEC : batch->takiToken[lane];
+        batch->phase[lane] = apply ? (over ? PHASE_GAME_OVER : lastDraw ? PHASE_PICK_CARD : batch->nextPhase[lane]) : batch->phase[lane];
+    }
+#endif
+}
+
+void nextBatchRands(Batch* batch, unsigned char need[], uint64_t rands[])
+{
+    // nextRand on the generators of the lanes with need set, the others are left as they are.
+    // Every lane of a group is computed and the new state is kept only where it's needed, a group where nothing is needed is skipped.
+    // Return value (rands) - The next 64 random bits of each lane that needed them.
+
+    uint64_t (*rng)[BATCH_MAX_LANES] = batch->rng;
+    uint64_t any[2];
+    int group, lane;
+
+#if defined(__AVX2__)
+    __m256i s0, s1, s2, s3, t, r, take;
+    uint32_t bytes;
+#elif defined(TAKI_SSE2)
+    __m128i s0, s1, s2, s3, t, r, take;
+#else
+    uint64_t s0, s1, s2, s3, t, r, take;
+#endif
+
+    for (group = 0; group < batch->numOfLanes; group += BATCH_GROUP) {
+        memcpy(any, need + group, sizeof(any));
+        if ((any[0] | any[1]) == 0)
+            continue;
+
+#if defined(__AVX2__)
+        for (lane = group; lane < group + BATCH_GROUP; lane += 4) {
+            memcpy(&bytes, need + lane, sizeof(bytes));
+            take = _mm256_sub_epi64(_mm256_setzero_si256(), _mm256_cvtepu8_epi64(_mm_cvtsi32_si128((int)bytes)));
+            s0 = _mm256_loadu_si256((const __m256i*)(rng[0] + lane));
+            s1 = _mm256_loadu_si256((const __m256i*)(rng[1] + lane));
+            s2 = _mm256_loadu_si256((const __m256i*)(rng[2] + lane));
+            s3 = _mm256_loadu_si256((const __m256i*)(rng[3] + lane));
+
+            // s1 * 5, rotated by 7, * 9, the multiplications as shifts and additions.
+            r = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+            r = _mm256_or_si256(_mm256_slli_epi64(r, 7), _mm256_srli_epi64(r, 57));
+            r = _mm256_add_epi64(_mm256_slli_epi64(r, 3), r);
+            _mm256_storeu_si256((__m256i*)(rands + lane), r);
+
+            t = _mm256_slli_epi64(s1, 17);
+            s2 = _mm256_xor_si256(s2, s0);
+            s3 = _mm256_xor_si256(s3, s1);
+            s1 = _mm256_xor_si256(s1, s2);
+            s0 = _mm256_xor_si256(s0, s3);
+            s2 = _mm256_xor_si256(s2, t);
+            s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+
+            _mm256_storeu_si256((__m256i*)(rng[0] + lane), _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(rng[0] + lane)), s0, take));
+            _mm256_storeu_si256((__m256i*)(rng[1] + lane), _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(rng[1] + lane)), s1, take));
+            _mm256_storeu_si256((__m256i*)(rng[2] + lane), _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(rng[2] + lane)), s2, take));
+            _mm256_storeu_si256((__m256i*)(rng[3] + lane), _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i*)(rng[3] + lane)), s3, take));
+        }
+#elif defined(TAKI_SSE2)
+        for (lane = group; lane < group + BATCH_GROUP; lane += 2) {
+            take = _mm_set_epi64x(-(long long)need[lane + 1], -(long long)need[lane]);
+            s0 = _mm_loadu_si128((const __m128i*)(rng[0] + lane));
+            s1 = _mm_loadu_si128((const __m128i*)(rng[1] + lane));
+            s2 = _mm_loadu_si128((const __m128i*)(rng[2] + lane));
+            s3 = _mm_loadu_si128((const __m128i*)(rng[3] + lane));
+
+            r = _mm_add_epi64(_mm_slli_epi64(s1, 2), s1);
+            r = _mm_or_si128(_mm_slli_epi64(r, 7), _mm_srli_epi64(r, 57));
+            r = _mm_add_epi64(_mm_slli_epi64(r, 3), r);
+            _mm_storeu_si128((__m128i*)(rands + lane), r);
+
+            t = _mm_slli_epi64(s1, 17);
+            s2 = _mm_xor_si128(s2, s0);
+            s3 = _mm_xor_si128(s3, s1);
+            s1 = _mm_xor_si128(s1, s2);
+            s0 = _mm_xor_si128(s0, s3);
+            s2 = _mm_xor_si128(s2, t);
+            s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));
+
+            _mm_storeu_si128((__m128i*)(rng[0] + lane), SELECT_BYTES(take, s0, _mm_loadu_si128((const __m128i*)(rng[0] + lane))));
+            _mm_storeu_si128((__m128i*)(rng[1] + lane), SELECT_BYTES(take, s1, _mm_loadu_si128((const __m128i*)(rng[1] + lane))));
+            _mm_storeu_si128((__m128i*)(rng[2] + lane), SELECT_BYTES(take, s2, _mm_loadu_si128((const __m128i*)(rng[2] + lane))));
+            _mm_storeu_si128((__m128i*)(rng[3] + lane), SELECT_BYTES(take, s3, _mm_loadu_si128((const __m128i*)(rng[3] + lane))));
+        }
+#else
+        for (lane = group; lane < group + BATCH_GROUP; lane++) {
+            s0 = rng[0][lane];
+            s1 = rng[1][lane];
+            s2 = rng[2][lane];
+            s3 = rng[3][lane];
+
+            r = s1 * 5;
+            rands[lane] = ((r << 7) | (r >> 57)) * 9;
+
+            t = s1 << 17;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            s3 = (s3 << 45) | (s3 >> 19);
+
+            take = (uint64_t)0 - (uint64_t)need[lane];
+            rng[0][lane] ^= (rng[0][lane] ^ s0) & take;
+            rng[1][lane] ^= (rng[1][lane] ^ s1) & take;
+            rng[2][lane] ^= (rng[2][lane] ^ s2) & take;
+            rng[3][lane] ^= (rng[3][lane] ^ s3) & take;
+        }
+#endif
+    }
+}
+
+void drawBatchRand(Batch* batch, unsigned char need[], uint32_t n, uint32_t values[])
+{
+    // getRandInRange for every lane with need set, on the generators of the lanes.
+    // The rare lanes rejected by Lemire's method draw again in another pass.
+    // Return value (values) - A random number in the range 1 - n for each lane that needed one, need is cleared.
+
+    uint64_t rands[BATCH_MAX_LANES], m;
+    uint32_t threshold = (uint32_t)(-n) % n;
+    unsigned char retry = 1;
+    int lane;
+
+    while (retry) {
+        nextBatchRands(batch, need, rands);
+        retry = 0;
+        for (lane = 0; lane < batch->numOfLanes; lane++) {
+            m = (rands[lane] >> 32) * n;
+            values[lane] = need[lane] ? (uint32_t)(m >> 32) + 1 : values[lane];
+            need[lane] = need[lane] & ((uint32_t)m < threshold);
+            retry |= need[lane];
+        }
+    }
+}
+
+void drawBatchCards(Batch* batch)
+{
+    // Drawing the cards of every lane that draws in the round, the kind and then the colour as drawCard does,
+    // and adding them to the hands of the movers.
+
+    unsigned char need[BATCH_MAX_LANES];
+    uint32_t kinds[BATCH_MAX_LANES], colours[BATCH_MAX_LANES];
+    int lane, kind, mover, any = 0;
+
+    for (lane = 0; lane < batch->numOfLanes; lane++) {
+        need[lane] = batch->needDraw[lane];
+        any |= need[lane];
+    }
+    if (!any)
+        return;
+
+    drawBatchRand(batch, need, batch->deckKinds == NULL ? CARDS_RANGE : (uint32_t)batch->numOfDeckKinds, kinds);
+    for (lane = 0; lane < batch->numOfLanes; lane++) {
+        if (batch->needDraw[lane] && batch->deckKinds != NULL)
+            kinds[lane] = batch->deckKinds[kinds[lane] - 1] + 1;
+        need[lane] = batch->needDraw[lane] && !(kindFlags[kinds[lane] - 1] & KIND_FLAG_WILD);
+        colours[lane] = NO_COLOR;
+    }
+    drawBatchRand(batch, need, COLOR_G, colours);
+
+    for (lane = 0; lane < batch->numOfLanes; lane++) {
+        if (!batch->needDraw[lane])
+            continue;
+
+        kind = kinds[lane] - 1;
+        mover = batch->mover[lane];
+        // A full hand can't take another card as in drawToHand, the random numbers of the lane are used all the same.
+        if (batch->handSize[mover][lane] == HAND_MAX)
+            continue;
+        if (batch->handSize[mover][lane] == batch->handCapacity[mover][lane]) {
+            batch->handCapacity[mover][lane] = batch->handCapacity[mover][lane] * 2 < HAND_MAX
+                ? batch->handCapacity[mover][lane] * 2 : HAND_MAX;
+            batch->hands[mover][lane] = (Card*)realloc(batch->hands[mover][lane], batch->handCapacity[mover][lane]);
+            checkCardAlloc(batch->hands[mover][lane]);
+        }
+        batch->hands[mover][lane][batch->handSize[mover][lane]++] = MAKE_CARD(kind, colours[lane]);
+        batch->histogram.count[kind]++;
+    }
+}
+
+bool playBatchRound(Batch* batch)
+{
+    // Advancing every active game of the batch by one action, the games that end are counted and their lanes refilled.
+    // Return value - false once every lane is stopped.
+
+    int lane;
+    bool any = false;
+
+    memset(batch->apply, 0, sizeof(batch->apply));
+    memset(batch->needDraw, 0, sizeof(batch->needDraw));
+    for (lane = 0; lane < batch->numOfLanes; lane++) {
+        if (batch->active[lane])
+            decideLane(batch, lane);
+    }
+    applyBatchRules(batch);
+    drawBatchCards(batch);
+
+    for (lane = 0; lane < batch->numOfLanes; lane++) {
+        if (batch->active[lane] && batch->phase[lane] == PHASE_GAME_OVER) {
+            batch->wins[batch->mover[lane]]++;
+            refillLane(batch, lane);
+        }
+        any |= batch->active[lane];
+    }
+    return any;
+}
+
+errorCode runBatch(int numOfGames, int numOfPlayers, char* strategyName, uint64_t seed, int numOfLanes)
+{
+    // Simulating games in lockstep batches and printing the results as runSimulation does, the results are the same.
+    // int numOfLanes - The amount of games advanced together.
+    // Return value - ERROR_INVALID if the strategy can't be played in a batch, the sizes are out of range
+    //                or the deck is finite (the lanes make every card at random), else ERROR_OK.
+
+    Strategy* strategy;
+    Batch* batch;
+    long long rounds = 0;
+    double start, seconds;
+    int i;
+
+    if (numOfPlayers > BATCH_MAX_PLAYERS || numOfLanes < 1 || numOfLanes > BATCH_MAX_LANES || numOfDeckCards > 0
+        || (strcmp(strategyName, "random") != 0 && strcmp(strategyName, "greedy") != 0))
+        return ERROR_INVALID;
+    strategy = newStrategy(strategyName, 1, seed);
+    batch = newBatch(numOfLanes, numOfPlayers, strategy, numOfGames, seed);
+
+    start = wallSeconds();
+    while (playBatchRound(batch))
+        rounds++;
+    seconds = wallSeconds() - start;
+
+    printf("Simulated %d games of %d players in %d lanes in %.2f seconds (%.0f games/sec, %.0f lane rounds/sec), seed %llu\n",
+        numOfGames, numOfPlayers, numOfLanes, seconds, seconds > 0 ? numOfGames / seconds : 0.0,
+        seconds > 0 ? (double)rounds * numOfLanes / seconds : 0.0, (unsigned long long)seed);
+    for (i = 0; i < numOfPlayers; i++)
+        printf("%s #%d won %lld games\n", BOT_NAME, i + 1, batch->wins[i]);
+    printHistogram(&batch->histogram);
+
+    freeBatch(batch);
+    freeStrategy(strategy);
+    return ERROR_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Streaming statistics //////////////////////////////////////////////////
+
+void pushRunningStat(RunningStat* stat, double value)
+{
+    // Adding a value to the running statistics.
+
+    double delta = value - stat->mean;
+
+    if (stat->count == 0 || value < stat->min)
+        stat->min = value;
+    if (stat->count == 0 || value > stat->max)
+        stat->max = value;
+    stat->count++;
+    stat->mean += delta / stat->count;
+    stat->m2 += delta * (value - stat->mean);
+}
+
+void mergeRunningStat(RunningStat* dest, RunningStat* source)
+{
+    // Adding the values of one running statistics to another, with the pairwise formula of Chan et al.
+
+    long long count = dest->count + source->count;
+    double delta = source->mean - dest->mean;
+
+    if (source->count == 0)
+        return;
+    if (dest->count == 0) {
+        *dest = *source;
+        return;
+    }
+
+    dest->mean += delta * source->count / count;
+    dest->m2 += source->m2 + delta * delta * ((double)dest->count * source->count / count);
+    if (source->min < dest->min)
+        dest->min = source->min;
+    if (source->max > dest->max)
+        dest->max = source->max;
+    dest->count = count;
+}
+
+double runningStdDev(RunningStat* stat)
+{
+    // Return value - The sample standard deviation of the values, 0 for less than two values.
+
+    return stat->count > 1 ? sqrt(stat->m2 / (stat->count - 1)) : 0.0;
+}
+
+int sketchBucket(uint64_t value)
+{
+    // Return value - The bucket of the value in a quantile sketch.
+    // A value with its highest bit at b >= SKETCH_SUB_BITS + 1 is shifted right until only SKETCH_SUB_BITS + 1 bits are left,
+    // the top bit always set, so each power of two gets 2^SKETCH_SUB_BITS buckets after the SKETCH_EXACT exact ones.
+
+    int shift;
+
+    if (value < SKETCH_EXACT)
+        return (int)value;
+    shift = highestBit(value) - SKETCH_SUB_BITS;
+    return (shift << SKETCH_SUB_BITS) + (int)(value >> shift);
+}
+
+double sketchValue(int bucket)
+{
+    // Return value - The middle of the values that fall in the bucket of a quantile sketch.
+
+    double width, low;
+    int shift;
+
+    if (bucket < SKETCH_EXACT)
+        return bucket;
+    shift = (bucket >> SKETCH_SUB_BITS) - 1;
+    width = (double)(1ull << shift);
+    low = ((bucket & ((1 << SKETCH_SUB_BITS) - 1)) + (1 << SKETCH_SUB_BITS)) * width;
+    return low + (width - 1) / 2;
+}
+
+void pushSketch(QuantileSketch* sketch, uint64_t value)
+{
+    sketch->buckets[sketchBucket(value)]++;
+    sketch->count++;
+}
+
+void mergeSketch(QuantileSketch* dest, QuantileSketch* source)
+{
+    int i;
+
+    for (i = 0; i < SKETCH_BUCKETS; i++)
+        dest->buckets[i] += source->buckets[i];
+    dest->count += source->count;
+}
+
+double sketchQuantile(QuantileSketch* sketch, double quantile)
+{
+    // Finding the value a fraction of the values is below.
+    // double quantile - The fraction, 0 - 1.
+    // Return value - The value, exact below SKETCH_EXACT and within 1/32 of it above. 0 for an empty sketch.
+
+    long long rank, seen = 0;
+    int i;
+
+    if (sketch->count == 0)
+        return 0.0;
+    rank = (long long)(quantile * (sketch->count - 1));
+    for (i = 0; i < SKETCH_BUCKETS; i++) {
+        seen += sketch->buckets[i];
+        if (seen > rank)
+            return sketchValue(i);
+    }
+    return sketchValue(SKETCH_BUCKETS - 1);
+}
+
+void initGameStats(GameStats* stats, int numOfSeats)
+{
+    // Initializing empty statistics of games with the given amount of seats.
+    // The counters of the seats are whole cache lines, each tournament worker keeps its own statistics.
+
+    size_t size = (sizeof(long long) * numOfSeats + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+    memset(stats, 0, sizeof(GameStats));
+    stats->numOfSeats = numOfSeats;
+    stats->seatWins = (long long*)allocCacheLines(size);
+    stats->seatCardsLeft = (long long*)allocCacheLines(size);
+    memset(stats->seatWins, 0, size);
+    memset(stats->seatCardsLeft, 0, size);
+}
+
+void freeGameStats(GameStats* stats)
+{
+    freeCacheLines(stats->seatWins);
+    freeCacheLines(stats->seatCardsLeft);
+    stats->seatWins = NULL;
+    stats->seatCardsLeft = NULL;
+}
+
+void endStatsRun(GameStats* stats)
+{
+    // Adding the length of the TAKI run that ended to the statistics, called by endTakiRun.
+
+    pushRunningStat(&stats->runStat, stats->runCards);
+    pushSketch(&stats->runSketch, (uint64_t)stats->runCards);
+    stats->runCards = 0;
+}
+
+void endStatsGame(GameStats* stats, Player* players, int winner)
+{
+    // Adding the game that ended to the statistics and starting to count the next one.
+    // Player* players - The players of the game, by their seats.
+    // int winner - The seat of the winner, or NO_WINNER.
+
+    int group = stats->flips < STATS_FLIP_GROUPS - 1 ? stats->flips : STATS_FLIP_GROUPS - 1;
+    int i;
+
+    stats->games++;
+    pushRunningStat(&stats->moveStat, stats->moves);
+    pushSketch(&stats->moveSketch, (uint64_t)stats->moves);
+    pushRunningStat(&stats->flipStat, stats->flips);
+
+    if (winner != NO_WINNER)
+        stats->seatWins[winner]++;
+    for (i = 0; i < stats->numOfSeats; i++)
+        stats->seatCardsLeft[i] += players[i].handSize;
+
+    stats->flipGames[group]++;
+    stats->flipMoves[group] += stats->moves;
+    if (winner == FIRST_PLAYER)
+        stats->flipStarterWins[group]++;
+
+    stats->moves = 0;
+    stats->flips = 0;
+    stats->runCards = 0;
+}
+
+void mergeGameStats(GameStats* dest, GameStats* source)
+{
+    // Adding the statistics of a thread to the total statistics, both must have the same amount of seats.
+
+    int i;
+
+    dest->games += source->games;
+    mergeRunningStat(&dest->moveStat, &source->moveStat);
+    mergeRunningStat(&dest->runStat, &source->runStat);
+    mergeRunningStat(&dest->flipStat, &source->flipStat);
+    mergeSketch(&dest->moveSketch, &source->moveSketch);
+    mergeSketch(&dest->runSketch, &source->runSketch);
+    for (i = 0; i < dest->numOfSeats; i++) {
+        dest->seatWins[i] += source->seatWins[i];
+        dest->seatCardsLeft[i] += source->seatCardsLeft[i];
+    }
+    for (i = 0; i < STATS_FLIP_GROUPS; i++) {
+        dest->flipGames[i] += source->flipGames[i];
+        dest->flipStarterWins[i] += source->flipStarterWins[i];
+        dest->flipMoves[i] += source->flipMoves[i];
+    }
+}
+
+void writeDistributionJson(FILE* file, const char* name, RunningStat* stat, QuantileSketch* sketch)
+{
+    // Writing the running statistics of a value and its quantiles as a JSON member, sketch may be NULL.
+
+    fprintf(file, "  \"%s\": { \"count\": %lld, \"mean\": %.4f, \"stddev\": %.4f, \"min\": %.0f, \"max\": %.0f",
+        name, stat->count, stat->mean, runningStdDev(stat), stat->min, stat->max);
+    if (sketch != NULL) {
+        fprintf(file, ", \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"p999\": %.1f", sketchQuantile(sketch, 0.5),
+            sketchQuantile(sketch, 0.9), sketchQuantile(sketch, 0.99), sketchQuantile(sketch, 0.999));
+    }
+    fprintf(file, " },\n");
+}
+
+void writeDistributionCsv(FILE* file, const char* name, RunningStat* stat, QuantileSketch* sketch)
+{
+    // Writing the running statistics of a value and its quantiles as CSV rows, sketch may be NULL.
+
+    fprintf(file, "%s,count,%lld\n%s,mean,%.4f\n%s,stddev,%.4f\n%s,min,%.0f\n%s,max,%.0f\n", name, stat->count,
+        name, stat->mean, name, runningStdDev(stat), name, stat->min, name, stat->max);
+    if (sketch != NULL) {
+        fprintf(file, "%s,p50,%.1f\n%s,p90,%.1f\n%s,p99,%.1f\n%s,p999,%.1f\n", name, sketchQuantile(sketch, 0.5),
+            name, sketchQuantile(sketch, 0.9), name, sketchQuantile(sketch, 0.99), name, sketchQuantile(sketch, 0.999));
+    }
+}
+
+void writeGameStats(GameStats* stats, const char* path)
+{
+    // Writing the statistics to a file, as CSV rows of metric,key,value when the path ends with STATS_CSV_SUFFIX, else as JSON.
+    // The flip groups hold the games by the times the rotation was reversed, the last group the games with more.
+
+    size_t length = strlen(path), suffix = strlen(STATS_CSV_SUFFIX);
+    bool csv = length >= suffix && strcmp(path + length - suffix, STATS_CSV_SUFFIX) == 0;
+    FILE* file = fopen(path, "w");
+    double games;
+    int i;
+
+    if (file == NULL) {
+        printf("Error: Could not open %s !\n", path);
+        return;
+    }
+
+    if (csv) {
+        fprintf(file, "metric,key,value\ngames,all,%lld\n", stats->games);
+        writeDistributionCsv(file, "moves", &stats->moveStat, &stats->moveSketch);
+        writeDistributionCsv(file, "taki_run_cards", &stats->runStat, &stats->runSketch);
+        writeDistributionCsv(file, "rotation_flips", &stats->flipStat, NULL);
+        for (i = 0; i < stats->numOfSeats; i++) {
+            fprintf(file, "seat_wins,%d,%lld\nseat_cards_left,%d,%lld\n",
+                i + 1, stats->seatWins[i], i + 1, stats->seatCardsLeft[i]);
+        }
+        for (i = 0; i < STATS_FLIP_GROUPS; i++) {
+            fprintf(file, "flip_games,%d%s,%lld\nflip_starter_wins,%d%s,%lld\nflip_moves,%d%s,%lld\n",
+                i, i == STATS_FLIP_GROUPS - 1 ? "+" : "", stats->flipGames[i], i, i == STATS_FLIP_GROUPS - 1 ? "+" : "",
+                stats->flipStarterWins[i], i, i == STATS_FLIP_GROUPS - 1 ? "+" : "", stats->flipMoves[i]);
+        }
+    }
+    else {
+        games = stats->games > 0 ? (double)stats->games : 1.0;
+        fprintf(file, "{\n  \"games\": %lld,\n", stats->games);
+        writeDistributionJson(file, "moves", &stats->moveStat, &stats->moveSketch);
+        writeDistributionJson(file, "taki_run_cards", &stats->runStat, &stats->runSketch);
+        writeDistributionJson(file, "rotation_flips", &stats->flipStat, NULL);
+        fprintf(file, "  \"seats\": [");
+        for (i = 0; i < stats->numOfSeats; i++) {
+            fprintf(file, "%s\n    { \"seat\": %d, \"wins\": %lld, \"win_rate\": %.4f, \"cards_left\": %.4f }", i > 0 ? "," : "",
+                i + 1, stats->seatWins[i], stats->seatWins[i] / games, stats->seatCardsLeft[i] / games);
+        }
+        fprintf(file, "\n  ],\n  \"flips\": [");
+        for (i = 0; i < STATS_FLIP_GROUPS; i++) {
+            fprintf(file, "%s\n    { \"flips\": \"%d%s\", \"games\": %lld, \"starter_win_rate\": %.4f, \"mean_moves\": %.2f }",
+                i > 0 ? "," : "", i, i == STATS_FLIP_GROUPS - 1 ? "+" : "", stats->flipGames[i],
+                stats->flipGames[i] > 0 ? (double)stats->flipStarterWins[i] / stats->flipGames[i] : 0.0,
+                stats->flipGames[i] > 0 ? (double)stats->flipMoves[i] / stats->flipGames[i] : 0.0);
+        }
+        fprintf(file, "\n  ]\n}\n");
+    }
+    fclose(file);
+    printf("Statistics of %lld games written to %s\n", stats->games, path);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Multi-threaded tournament ////////////////////////////////////////////
+
+int getCoreCount()
+{
+    // Return value - The amount of cores available to the program, at least 1.
+
+#ifdef _WIN32
+    SYSTEM_INFO sysInfo;
+
+    GetSystemInfo(&sysInfo);
+    return (int)sysInfo.dwNumberOfProcessors;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return cores > 0 ? (int)cores : 1;
+#endif
+}
+
+double wallSeconds()
+{
+    // Return value - The wall clock time in seconds, clock() can't be used because it sums the time of all the threads.
+
+    struct timespec now;
+
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void* allocCacheLines(size_t size)
+{
+    // Allocating a block that starts on a cache line, for data written by one thread that others must not share a line with.
+    // size_t size - The size of the block, a whole amount of cache lines.
+    // Return value - The block, freed with freeCacheLines.
+
+#ifdef _WIN32
+    void* block = _aligned_malloc(size, CACHE_LINE);
+#else
+    void* block = aligned_alloc(CACHE_LINE, size);
+#endif
+
+    if (block == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    return block;
+}
+
+void freeCacheLines(void* block)
+{
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+void initWorkQueue(WorkQueue* queue, long capacity)
+{
+    // Initializing an empty work queue that can hold up to capacity tasks.
+
+    atomic_init(&queue->top, 0);
+    atomic_init(&queue->bottom, 0);
+    queue->capacity = capacity;
+    queue->tasks = (int*)malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+    if (queue->tasks == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+}
+
+void pushTask(WorkQueue* queue, int task)
+{
+    // Pushing a task to the bottom of the queue, only the owner of the queue may push.
+
+    long bottom = atomic_load_explicit(&queue->bottom, memory_order_relaxed);
+
+    queue->tasks[bottom % queue->capacity] = task;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_relaxed);
+}
+
+int takeTask(WorkQueue* queue)
+{
+    // Taking a task from the bottom of the queue, only the owner of the queue may take.
+    // Return value - The task, or TASK_EMPTY if the queue is empty.
+
+    long bottom = atomic_load_explicit(&queue->bottom, memory_order_relaxed) - 1;
+    long top;
+    int task = TASK_EMPTY;
+
+    atomic_store_explicit(&queue->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    top = atomic_load_explicit(&queue->top, memory_order_relaxed);
+
+    if (top <= bottom) {
+        task = queue->tasks[bottom % queue->capacity];
+        if (top == bottom) {
+            // The last task, racing with the thieves for it.
+            if (!atomic_compare_exchange_strong_explicit(&queue->top, &top, top + 1,
+                memory_order_seq_cst, memory_order_relaxed))
+                task = TASK_EMPTY;
+            atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_relaxed);
+        }
+    }
+    else {
+        atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+int stealTask(WorkQueue* queue)
+{
+    // Stealing a task from the top of the queue of another worker.
+    // Return value - The task, TASK_EMPTY if the queue is empty or TASK_ABORT if another thread took the task first.
+
+    long top = atomic_load_explicit(&queue->top, memory_order_acquire);
+    long bottom;
+    int task;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    bottom = atomic_load_explicit(&queue->bottom, memory_order_acquire);
+
+    if (top >= bottom)
+        return TASK_EMPTY;
+
+    task = queue->tasks[top % queue->capacity];
+    if (!atomic_compare_exchange_strong_explicit(&queue->top, &top, top + 1,
+        memory_order_seq_cst, memory_order_relaxed))
+        return TASK_ABORT;
+    return task;
+}
+
+void getMatchup(Tournament* tournament, int matchup, int* first, int* second)
+{
+    // Returning the pair of strategies of a matchup, every pair of different strategies is a matchup.
+    // With a single strategy there is one matchup, the strategy against itself.
+
+    int i, j;
+
+    *first = *second = 0;
+    for (i = 0; i < tournament->numOfStrategies; i++) {
+        for (j = i + 1; j < tournament->numOfStrategies; j++) {
+            if (matchup-- == 0) {
+                *first = i;
+                *second = j;
+                return;
+            }
+        }
+    }
+}
+
+int seatStrategy(Tournament* tournament, TournamentTask* task, int seat)
+{
+    // Return value - The index of the strategy sitting in the given seat, the strategies of the matchup alternate between the seats.
+
+    int first, second;
+
+    getMatchup(tournament, task->matchup, &first, &second);
+    return ((seat + task->rotation) % 2 == 0) ? first : second;
+}
+
+void buildTournamentTasks(Tournament* tournament)
+{
+    // Splitting the games between every matchup and every rotation of the seats, and dealing the tasks to the queues of the workers.
+
+    int slots = tournament->numOfMatchups * tournament->numOfPlayers;
+    int matchup, rotation, slot, games, chunk, firstGame = 0;
+    int maxTasks = tournament->numOfGames / TOURNAMENT_CHUNK + slots + 1;
+    int i;
+
+    tournament->tasks = (TournamentTask*)malloc(sizeof(TournamentTask) * maxTasks);
+    if (tournament->tasks == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+
+    tournament->numOfTasks = 0;
+    for (slot = 0; slot < slots; slot++) {
+        matchup = slot / tournament->numOfPlayers;
+        rotation = slot % tournament->numOfPlayers;
+        games = tournament->numOfGames / slots + (slot < tournament->numOfGames % slots ? 1 : 0);
+
+        while (games > 0) {
+            chunk = games < TOURNAMENT_CHUNK ? games : TOURNAMENT_CHUNK;
+            tournament->tasks[tournament->numOfTasks].matchup = matchup;
+            tournament->tasks[tournament->numOfTasks].rotation = rotation;
+            tournament->tasks[tournament->numOfTasks].firstGame = firstGame;
+            tournament->tasks[tournament->numOfTasks].numOfGames = chunk;
+            tournament->numOfTasks++;
+            firstGame += chunk;
+            games -= chunk;
+        }
+    }
+
+    for (i = 0; i < tournament->numOfThreads; i++)
+        initWorkQueue(&tournament->queues[i], tournament->numOfTasks);
+    for (i = 0; i < tournament->numOfTasks; i++)
+        pushTask(&tournament->queues[i % tournament->numOfThreads], i);
+}
+
+int nextTournamentTask(TournamentWorker* worker)
+{
+    // Returning the next task of the worker, from its own queue or stolen from another worker.
+    // Return value - The index of the task, or TASK_EMPTY when every queue is empty.
+
+    Tournament* tournament = worker->tournament;
+    int task = takeTask(&tournament->queues[worker->id]);
+    int i;
+    bool aborted;
+
+    if (task != TASK_EMPTY)
+        return task;
+
+    // No new tasks are pushed once the workers start, so the work is done when a sweep finds every queue empty.
+    do {
+        aborted = false;
+        for (i = 1; i < tournament->numOfThreads; i++) {
+            task = stealTask(&tournament->queues[(worker->id + i) % tournament->numOfThreads]);
+            if (task >= 0)
+                return task;
+            if (task == TASK_ABORT)
+                aborted = true;
+        }
+    } while (aborted);
+
+    return TASK_EMPTY;
+}
+
+void playTournamentTask(TournamentWorker* worker, TournamentTask* task)
+{
+    // Playing the games of a task and recording the results in the statistics of the worker.
+
+    Tournament* tournament = worker->tournament;
+    int lineup[MAX_PLAYERS_LINEUP];
+    int seat, game, winner;
+
+    for (seat = 0; seat < tournament->numOfPlayers; seat++) {
+        lineup[seat] = seatStrategy(tournament, task, seat);
+        worker->players[seat].strategy = worker->strategies[lineup[seat]];
+    }
+
+    for (game = 0; game < task->numOfGames; game++) {
+        winner = playHeadlessGame(&worker->info, worker->players, tournament->seed + task->firstGame + game);
+
+        worker->stats.games++;
+        if (winner != NO_WINNER) {
+            worker->stats.seatWins[winner]++;
+            worker->stats.strategyWins[lineup[winner]]++;
+        }
+        for (seat = 0; seat < tournament->numOfPlayers; seat++)
+            worker->stats.strategySeats[lineup[seat]]++;
+        if (tournament->live != NULL)
+            publishLiveCounters(worker);
+    }
+}
+
+int tournamentWorkerMain(void* arg)
+{
+    // The main function of each worker thread.
+
+    TournamentWorker* worker = (TournamentWorker*)arg;
+    int task;
+
+    while ((task = nextTournamentTask(worker)) != TASK_EMPTY)
+        playTournamentTask(worker, &worker->tournament->tasks[task]);
+
+    INSTR_MERGE();
+    return 0;
+}
+
+void mergeTournamentStats(TournamentStats* dest, TournamentStats* source, int numOfPlayers)
+{
+    // Adding the statistics of a worker to the total statistics.
+
+    int i;
+
+    dest->games += source->games;
+    for (i = 0; i < numOfPlayers; i++)
+        dest->seatWins[i] += source->seatWins[i];
+    for (i = 0; i < MAX_STRATEGIES; i++) {
+        dest->strategyWins[i] += source->strategyWins[i];
+        dest->strategySeats[i] += source->strategySeats[i];
+    }
+}
+
+void initLiveCounters(LiveCounters* live)
+{
+    int i;
+
+    atomic_init(&live->games, 0);
+    for (i = 0; i < MAX_PLAYERS_LINEUP; i++)
+        atomic_init(&live->seatWins[i], 0);
+    for (i = 0; i < MAX_STRATEGIES; i++) {
+        atomic_init(&live->strategyWins[i], 0);
+        atomic_init(&live->strategySeats[i], 0);
+    }
+    for (i = 0; i < CARDS_RANGE; i++)
+        atomic_init(&live->draws[i], 0);
+}
+
+void publishLiveCounters(TournamentWorker* worker)
+{
+    // Storing the totals of the worker in its live block, called by the worker after each game.
+    // The worker is the only writer of the block, so plain stores of its totals are enough, without any atomic addition.
+
+    Tournament* tournament = worker->tournament;
+    LiveCounters* live = &tournament->live[worker->id];
+    int i;
+
+    for (i = 0; i < tournament->numOfPlayers; i++)
+        atomic_store_explicit(&live->seatWins[i], worker->stats.seatWins[i], memory_order_relaxed);
+    for (i = 0; i < tournament->numOfStrategies; i++) {
+        atomic_store_explicit(&live->strategyWins[i], worker->stats.strategyWins[i], memory_order_relaxed);
+        atomic_store_explicit(&live->strategySeats[i], worker->stats.strategySeats[i], memory_order_relaxed);
+    }
+    for (i = 0; i < CARDS_RANGE; i++)
+        atomic_store_explicit(&live->draws[i], worker->info.histogram.count[i], memory_order_relaxed);
+    atomic_store_explicit(&live->games, worker->stats.games, memory_order_relaxed);
+}
+
+void sumLiveCounters(Tournament* tournament, TournamentStats* total, Histogram* histogram)
+{
+    // Taking a snapshot of the results of every worker so far, the workers go on playing.
+    // TournamentStats* total - Set to the sum of the workers.
+    // Histogram* histogram - Set to the sum of the histograms of the workers.
+
+    LiveCounters* live;
+    int i, j;
+
+    total->games = 0;
+    memset(total->seatWins, 0, sizeof(total->seatWins));
+    memset(total->strategyWins, 0, sizeof(total->strategyWins));
+    memset(total->strategySeats, 0, sizeof(total->strategySeats));
+    initHistogram(histogram);
+
+    for (i = 0; i < tournament->numOfThreads; i++) {
+        live = &tournament->live[i];
+
+        total->games += atomic_load_explicit(&live->games, memory_order_relaxed);
+        for (j = 0; j < tournament->numOfPlayers; j++)
+            total->seatWins[j] += atomic_load_explicit(&live->seatWins[j], memory_order_relaxed);
+        for (j = 0; j < tournament->numOfStrategies; j++) {
+            total->strategyWins[j] += atomic_load_explicit(&live->strategyWins[j], memory_order_relaxed);
+            total->strategySeats[j] += atomic_load_explicit(&live->strategySeats[j], memory_order_relaxed);
+        }
+        for (j = 0; j < CARDS_RANGE; j++)
+            histogram->count[j] += atomic_load_explicit(&live->draws[j], memory_order_relaxed);
+    }
+}
+
+void printProgress(Tournament* tournament, TournamentStats* total, Histogram* histogram)
+{
+    // Printing one line of the results so far, the win rate of each strategy and the card drawn the most.
+
+    unsigned char rank[CARDS_RANGE];
+    double seconds = wallSeconds() - tournament->start;
+    int i;
+
+    sortHistogram(histogram, rank);
+    printf("[%7.2fs] %lld / %d games (%.0f games/sec) |", seconds, total->games, tournament->numOfGames,
+        seconds > 0 ? total->games / seconds : 0.0);
+    for (i = 0; i < tournament->numOfStrategies; i++) {
+        printf(" %s %.4f", tournament->strategyNames[i],
+            total->strategySeats[i] > 0 ? (double)total->strategyWins[i] / total->strategySeats[i] : 0.0);
+    }
+    printf(" | most drawn %s\n", cardTypeStr[rank[0]]);
+    fflush(stdout);
+}
+
+int progressMain(void* arg)
+{
+    // The main function of the progress thread, printing a snapshot of the tournament every interval until it is over.
+
+    Tournament* tournament = (Tournament*)arg;
+    TournamentStats total = { 0 };
+    Histogram histogram;
+    struct timespec poll = { 0, PROGRESS_POLL_NS };
+    double next = tournament->start + tournament->progressMs / 1000.0;
+
+    while (!atomic_load_explicit(&tournament->done, memory_order_acquire)) {
+        thrd_sleep(&poll, NULL);
+        if (wallSeconds() >= next) {
+            sumLiveCounters(tournament, &total, &histogram);
+            printProgress(tournament, &total, &histogram);
+            next += tournament->progressMs / 1000.0;
+        }
+    }
+
+    return 0;
+}
+
+void printTournamentResults(Tournament* tournament, TournamentStats* total, Histogram* histogram, double seconds)
+{
+    // Printing the merged results of the tournament.
+
+    Strategy* instances[MAX_THREADS];
+    int i, j;
+
+    printf("Tournament of %lld games of %d players on %d threads in %.2f seconds (%.0f games/sec), seed %llu\n",
+        total->games, tournament->numOfPlayers, tournament->numOfThreads, seconds,
+        seconds > 0 ? total->games / seconds : 0.0, (unsigned long long)tournament->seed);
+
+    printf("\nStrategy | Seats      | Wins       | Win rate\n");
+    for (i = 0; i < tournament->numOfStrategies; i++) {
+        printf("%8s | %10lld | %10lld | %.4f\n", tournament->strategyNames[i], total->strategySeats[i], total->strategyWins[i],
+            total->strategySeats[i] > 0 ? (double)total->strategyWins[i] / total->strategySeats[i] : 0.0);
+    }
+
+    printf("\nSeat | Wins\n");
+    for (i = 0; i < tournament->numOfPlayers; i++)
+        printf("%4d | %lld\n", i + 1, total->seatWins[i]);
+
+    printf("\n");
+    for (i = 0; i < tournament->numOfStrategies; i++) {
+        for (j = 0; j < tournament->numOfThreads; j++)
+            instances[j] = tournament->workers[j].strategies[i];
+        printStrategyReport(tournament->strategyNames[i], instances, tournament->numOfThreads);
+    }
+
+    printHistogram(histogram);
+    INSTR_DUMP();
+}
+
+errorCode runTournament(int numOfGames, int numOfPlayers, char* strategyList, int numOfThreads, uint64_t seed, RecordFile* record, const char* statsPath, int progressMs)
+{
+    // Running a tournament between the strategies on several threads.
+    // int numOfGames - The total amount of games.
+    // int numOfPlayers - The amount of players in each game.
+    // char* strategyList - Comma separated names of the strategies, i.e "random,greedy".
+    // int numOfThreads - The amount of worker threads, an ISMCTS player searches on the thread of its worker.
+    // uint64_t seed - Game number i is played with the seed + i. The random and greedy strategies draw from the generator
+    //                 of the game, so their results don't depend on the amount of threads. An ISMCTS player searches until
+    //                 a deadline and keeps the generator of its worker, so its games can't be repeated.
+    // RecordFile* record - The file the games are recorded to, or NULL. Each worker appends blocks of its own games.
+    // const char* statsPath - The file the statistics of the games are written to, or NULL. Each worker collects its own.
+    // int progressMs - The interval the results so far are printed at while the games are played, 0 for none.
+    // Return value - ERROR_INVALID if the arguments are invalid, else ERROR_OK.
+
+    Tournament tournament = { 0 };
+    TournamentStats total = { 0 };
+    GameStats totalStats;
+    Histogram histogram;
+    TournamentWorker* worker;
+    thrd_t threads[MAX_THREADS];
+    thrd_t progress;
+    Strategy* strategy;
+    char* name;
+    double start;
+    int i, j;
+
+    if (numOfPlayers > MAX_PLAYERS_LINEUP || numOfThreads < 1 || numOfThreads > MAX_THREADS)
+        return ERROR_INVALID;
+
+    for (name = strtok(strategyList, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (tournament.numOfStrategies == MAX_STRATEGIES || (strategy = newStrategy(name, 1, seed)) == NULL)
+            return ERROR_INVALID;
+        freeStrategy(strategy);
+        tournament.strategyNames[tournament.numOfStrategies++] = name;
+    }
+    if (tournament.numOfStrategies == 0)
+        return ERROR_INVALID;
+
+    tournament.numOfGames = numOfGames;
+    tournament.numOfPlayers = numOfPlayers;
+    tournament.numOfThreads = numOfThreads;
+    tournament.seed = seed;
+    tournament.record = record;
+    tournament.progressMs = progressMs;
+    atomic_init(&tournament.done, false);
+    tournament.numOfMatchups = tournament.numOfStrategies == 1 ? 1
+        : tournament.numOfStrategies * (tournament.numOfStrategies - 1) / 2;
+
+    tournament.queues = (WorkQueue*)malloc(sizeof(WorkQueue) * numOfThreads);
+    tournament.workers = (TournamentWorker*)allocCacheLines(sizeof(TournamentWorker) * numOfThreads);
+    memset(tournament.workers, 0, sizeof(TournamentWorker) * numOfThreads);
+    if (tournament.queues == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    buildTournamentTasks(&tournament);
+    if (progressMs > 0) {
+        tournament.live = (LiveCounters*)allocCacheLines(sizeof(LiveCounters) * numOfThreads);
+        for (i = 0; i < numOfThreads; i++)
+            initLiveCounters(&tournament.live[i]);
+    }
+
+    // Each worker owns its game info, players and decks, nothing is shared while the games are played.
+    for (i = 0; i < numOfThreads; i++) {
+        worker = &tournament.workers[i];
+
+        worker->tournament = &tournament;
+        worker->id = i;
+        worker->info.numOfPlayers = numOfPlayers;
+        worker->info.headless = true;
+        initHistogram(&worker->info.histogram);
+        initArena(&worker->info.arena, ARENA_INIT_CAPACITY);
+        if (record != NULL) {
+            initRecorder(&worker->recorder, record);
+            worker->info.recorder = &worker->recorder;
+        }
+        if (statsPath != NULL) {
+            initGameStats(&worker->gameStats, numOfPlayers);
+            worker->info.stats = &worker->gameStats;
+        }
+
+        for (j = 0; j < tournament.numOfStrategies; j++)
+            worker->strategies[j] = newStrategy(tournament.strategyNames[j], 1, seed + i);
+
+        initBotPlayers(worker->players, numOfPlayers, worker->strategies[0]);
+    }
+
+    start = wallSeconds();
+    tournament.start = start;
+    for (i = 0; i < numOfThreads; i++) {
+        if (thrd_create(&threads[i], tournamentWorkerMain, &tournament.workers[i]) != thrd_success) {
+            printf("Error: Could not create a thread !\n");
+            exit(1);
+        }
+    }
+    if (progressMs > 0 && thrd_create(&progress, progressMain, &tournament) != thrd_success) {
+        printf("Error: Could not create a thread !\n");
+        exit(1);
+    }
+    for (i = 0; i < numOfThreads; i++)
+        thrd_join(threads[i], NULL);
+    if (progressMs > 0) {
+        atomic_store_explicit(&tournament.done, true, memory_order_release);
+        thrd_join(progress, NULL);
+    }
+
+    initHistogram(&histogram);
+    for (i = 0; i < numOfThreads; i++) {
+        worker = &tournament.workers[i];
+
+        mergeTournamentStats(&total, &worker->stats, numOfPlayers);
+        mergeHistogram(&histogram, &worker->info.histogram);
+    }
+    printTournamentResults(&tournament, &total, &histogram, wallSeconds() - start);
+    if (statsPath != NULL) {
+        initGameStats(&totalStats, numOfPlayers);
+        for (i = 0; i < numOfThreads; i++)
+            mergeGameStats(&totalStats, &tournament.workers[i].gameStats);
+        writeGameStats(&totalStats, statsPath);
+        freeGameStats(&totalStats);
+    }
+
+    for (i = 0; i < numOfThreads; i++) {
+        worker = &tournament.workers[i];
+
+        freeArena(&worker->info.arena);
+        freeDeck(&worker->info.deck);
+        if (record != NULL)
+            freeRecorder(&worker->recorder);
+        if (statsPath != NULL)
+            freeGameStats(&worker->gameStats);
+        for (j = 0; j < tournament.numOfStrategies; j++)
+            freeStrategy(worker->strategies[j]);
+        free(tournament.queues[i].tasks);
+    }
+    freeCacheLines(tournament.live);
+    freeCacheLines(tournament.workers);
+    free(tournament.queues);
+    free(tournament.tasks);
+
+    return ERROR_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Game records //////////////////////////////////////////////////////////
+
+errorCode openRecordFile(RecordFile* record, char* path)
+{
+    // Creating a record file, an existing file is replaced.
+    // Return value - ERROR_INVALID if the file can't be created, else ERROR_OK.
+
+    record->file = fopen(path, "wb");
+    if (record->file == NULL)
+        return ERROR_INVALID;
+    fwrite(RECORD_MAGIC, 1, RECORD_MAGIC_LEN, record->file);
+    mtx_init(&record->lock, mtx_plain);
+
+    return ERROR_OK;
+}
+
+void closeRecordFile(RecordFile* record)
+{
+    fclose(record->file);
+    mtx_destroy(&record->lock);
+}
+
+void initRecorder(Recorder* recorder, RecordFile* record)
+{
+    // Initializing a recorder writing to the record file.
+
+    recorder->capacity = RECORD_BLOCK;
+    recorder->data = (unsigned char*)malloc(recorder->capacity);
+    if (recorder->data == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    recorder->length = 0;
+    recorder->position = 0;
+    recorder->replay = false;
+    recorder->mismatch = false;
+    recorder->file = record;
+}
+
+void recordEvent(GameInfo* info, unsigned char event)
+{
+    // Recording an event of the game, or comparing it with the log when the game is replayed.
+    // GameInfo* info - Pointer to the info of the game, nothing is done when it has no recorder.
+    // unsigned char event - The event, see EVENT_*.
+
+    Recorder* recorder = info->recorder;
+
+    if (recorder == NULL)
+        return;
+
+    if (recorder->replay) {
+        if (recorder->position < recorder->length && recorder->data[recorder->position] == event)
+            recorder->position++;
+        else
+            recorder->mismatch = true;
+        return;
+    }
+
+    // A single game may be longer than the block, the buffer grows until it's written.
+    if (recorder->length == recorder->capacity) {
+        recorder->capacity *= 2;
+        recorder->data = (unsigned char*)realloc(recorder->data, recorder->capacity);
+        if (recorder->data == NULL) {
+            printf("Error: Could not allocate memory !\n");
+            exit(1);
+        }
+    }
+    recorder->data[recorder->length++] = event;
+}
+
+void recordGameStart(GameInfo* info, Player* players, uint64_t seed)
+{
+    // Recording the start of a game, its seed and the position after dealing the cards.
+    // When replaying, the position of the replayed game is compared with the log like any other event.
+
+    int i, j;
+
+    recordEvent(info, EVENT_GAME);
+    for (i = 0; i < 8; i++)
+        recordEvent(info, (unsigned char)(seed >> (i * 8)));
+    recordEvent(info, (unsigned char)info->numOfPlayers);
+    recordEvent(info, info->topCard);
+    for (i = 0; i < info->numOfPlayers; i++) {
+        recordEvent(info, (unsigned char)players[i].handSize);
+        for (j = 0; j < players[i].handSize; j++)
+            recordEvent(info, players[i].deck[j]);
+    }
+}
+
+void flushRecorder(Recorder* recorder)
+{
+    // Appending the games held by the recorder to the file, only whole games are held so the games of the threads never mix.
+
+    if (recorder->length == 0)
+        return;
+
+    mtx_lock(&recorder->file->lock);
+    fwrite(recorder->data, 1, recorder->length, recorder->file->file);
+    mtx_unlock(&recorder->file->lock);
+    recorder->length = 0;
+}
+
+void freeRecorder(Recorder* recorder)
+{
+    flushRecorder(recorder);
+    free(recorder->data);
+    recorder->data = NULL;
+}
+
+errorCode mapRecordFile(RecordMap* map, char* path)
+{
+    // Mapping a record file to memory, the games are read straight from the pages of the file.
+    // Return value - ERROR_INVALID if the file can't be mapped or isn't a record file, else ERROR_OK.
+
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (map->file == INVALID_HANDLE_VALUE)
+        return ERROR_INVALID;
+    if (!GetFileSizeEx(map->file, &size) || size.QuadPart < RECORD_MAGIC_LEN) {
+        CloseHandle(map->file);
+        return ERROR_INVALID;
+    }
+    map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    map->data = map->mapping != NULL ? (const unsigned char*)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (map->data == NULL) {
+        if (map->mapping != NULL)
+            CloseHandle(map->mapping);
+        CloseHandle(map->file);
+        return ERROR_INVALID;
+    }
+    map->length = (size_t)size.QuadPart;
+#else
+    struct stat info;
+    void* data;
+    int file = open(path, O_RDONLY);
+
+    if (file < 0)
+        return ERROR_INVALID;
+    if (fstat(file, &info) != 0 || info.st_size < RECORD_MAGIC_LEN) {
+        close(file);
+        return ERROR_INVALID;
+    }
+    data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+        return ERROR_INVALID;
+    posix_madvise(data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+
+    map->data = (const unsigned char*)data;
+    map->length = (size_t)info.st_size;
+#endif
+
+    if (memcmp(map->data, RECORD_MAGIC, RECORD_MAGIC_LEN) != 0) {
+        unmapRecordFile(map);
+        return ERROR_INVALID;
+    }
+    return ERROR_OK;
+}
+
+void unmapRecordFile(RecordMap* map)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap((void*)map->data, map->length);
+#endif
+}
+
+uint64_t readSeed(const unsigned char* bytes)
+{
+    // Return value - The seed of a game, stored as 8 bytes from the lowest.
+
+    uint64_t seed = 0;
+    int i;
+
+    for (i = 7; i >= 0; i--)
+        seed = (seed << 8) | bytes[i];
+    return seed;
+}
+
+size_t skipGame(RecordMap* map, size_t position)
+{
+    // Finding the end of the game starting at the position.
+    // Return value - The position after the game, or 0 if the log is broken or ends in the middle of the game.
+
+    const unsigned char* data = map->data;
+    size_t length = map->length;
+    int numOfPlayers, i;
+
+    if (position + 11 > length || data[position] != EVENT_GAME)
+        return 0;
+    numOfPlayers = data[position + 9];
+    position += 11;
+    for (i = 0; i < numOfPlayers; i++) {
+        if (position >= length)
+            return 0;
+        position += 1 + data[position];
+    }
+
+    // Every event is a single byte, except for the end of the game which is followed by the winner.
+    while (position < length && data[position] != EVENT_GAME_END) {
+        if (data[position] == EVENT_GAME)
+            return 0;
+        position++;
+    }
+    return position + 2 <= length ? position + 2 : 0;
+}
+
+void scanRecords(RecordMap* map)
+{
+    // Summarizing the recorded games without playing them, one pass over the events.
+
+    const unsigned char* data = map->data;
+    long long games = 0, moves = 0, draws = 0, colours = 0, takiRuns = 0;
+    long long seatWins[RECORD_MAX_PLAYERS] = { 0 };
+    Histogram histogram;
+    size_t position = RECORD_MAGIC_LEN, next, header;
+    int numOfPlayers = 0, maxPlayers = 0, i;
+    unsigned char event;
+    double start = wallSeconds(), seconds;
+
+    initHistogram(&histogram);
+    while (position < map->length && (next = skipGame(map, position)) != 0) {
+        numOfPlayers = data[position + 9];
+        if (numOfPlayers > maxPlayers)
+            maxPlayers = numOfPlayers;
+
+        // Skipping the header, the events run until the end of the game.
+        header = position + 11;
+        for (i = 0; i < numOfPlayers; i++)
+            header += 1 + data[header];
+
+        for (position = header; position < next - 2; position++) {
+            event = data[position];
+            if (event < EVENT_DRAW)
+                moves++;
+            else if (event < EVENT_COLOR) {
+                draws++;
+                histogram.count[CARD_KIND(event - EVENT_DRAW)]++;
+            }
+            else if (event == EVENT_TAKI_END)
+                takiRuns++;
+            else
+                colours++;
+        }
+        if (data[next - 1] != (unsigned char)NO_WINNER)
+            seatWins[data[next - 1]]++;
+        games++;
+        position = next;
+    }
+    seconds = wallSeconds() - start;
+
+    printf("Scanned %lld games in %.2f seconds (%.0f events/sec)%s\n", games, seconds,
+        seconds > 0 ? (map->length - RECORD_MAGIC_LEN) / seconds : 0.0,
+        position < map->length ? ", the log ends with a broken game" : "");
+    printf("%lld cards placed, %lld drawn, %lld colours picked, %lld TAKI runs\n", moves, draws, colours, takiRuns);
+    printf("%zu bytes, %.2f bytes per move\n", map->length,
+        moves + draws > 0 ? (double)(map->length - RECORD_MAGIC_LEN) / (moves + draws) : 0.0);
+
+    printf("\nSeat | Wins\n");
+    for (i = 0; i < maxPlayers; i++)
+        printf("%4d | %lld\n", i + 1, seatWins[i]);
+
+    printHistogram(&histogram);
+}
+
+int replayPickCard(GameInfo* info, Player* player, void* context)
+{
+    // Strategy replaying the choices of the log, the events themselves are compared by recordEvent.
+    // Once the game doesn't match the log, it's finished with the greedy strategy.
+    // Return value - 0 for drawing a card or 1 - handSize.
+
+    Recorder* recorder = info->recorder;
+    unsigned char event;
+    int i;
+
+    (void)context;
+    if (!recorder->mismatch && recorder->position < recorder->length) {
+        event = recorder->data[recorder->position];
+        // A draw that found the deck empty ended the game without an event of its own.
+        if ((event >= EVENT_DRAW && event < EVENT_COLOR) || event == EVENT_GAME_END)
+            return 0;
+        for (i = 0; event < EVENT_DRAW && i < player->handSize; i++) {
+            if (player->deck[i] == event)
+                return i + 1;
+        }
+    }
+    recorder->mismatch = true;
+    return greedyPickCard(info, player, NULL);
+}
+
+int replayPickColor(GameInfo* info, Player* player, void* context)
+{
+    // Return value - The colour of the log, NO_COLOR when an invalid pick was recorded.
+
+    Recorder* recorder = info->recorder;
+    unsigned char event;
+
+    (void)context;
+    if (!recorder->mismatch && recorder->position < recorder->length) {
+        event = recorder->data[recorder->position];
+        if (event >= EVENT_COLOR && event <= EVENT_COLOR + COLOR_G)
+            return event - EVENT_COLOR;
+    }
+    recorder->mismatch = true;
+    return greedyPickColor(info, player, NULL);
+}
+
+void rerunRecords(RecordMap* map)
+{
+    // Playing every recorded game again from its seed with the choices of the log, through the rules of the game.
+    // Every event of the game must be the same as in the log, which checks both the log and the rules.
+
+    Strategy replayStrategy = { replayPickCard, replayPickColor, NULL };
+    Player players[RECORD_MAX_PLAYERS];
+    GameInfo info = { 0 };
+    Recorder recorder = { 0 };
+    long long games = 0, mismatches = 0;
+    size_t position = RECORD_MAGIC_LEN, next;
+    double start = wallSeconds(), seconds;
+
+    info.headless = true;
+    initHistogram(&info.histogram);
+    initArena(&info.arena, ARENA_INIT_CAPACITY);
+    initBotPlayers(players, RECORD_MAX_PLAYERS, &replayStrategy);
+
+    // The recorder reads the log in place.
+    recorder.data = (unsigned char*)map->data;
+    recorder.replay = true;
+    info.recorder = &recorder;
+
+    while (position < map->length && (next = skipGame(map, position)) != 0) {
+        info.numOfPlayers = map->data[position + 9];
+        recorder.position = position;
+        recorder.length = next;
+        recorder.mismatch = false;
+
+        if ((unsigned char)playHeadlessGame(&info, players, readSeed(map->data + position + 1)) != map->data[next - 1]
+            || recorder.mismatch || recorder.position != next) {
+            if (mismatches == 0)
+                printf("Game %lld (at byte %zu) doesn't match its record\n", games + 1, position);
+            mismatches++;
+        }
+        games++;
+        position = next;
+    }
+    seconds = wallSeconds() - start;
+
+    printf("Re-ran %lld games in %.2f seconds (%.0f games/sec), %lld didn't match their record\n",
+        games, seconds, seconds > 0 ? games / seconds : 0.0, mismatches);
+    freeArena(&info.arena);
+    freeDeck(&info.deck);
+}
+
+errorCode runReplay(char* path, char* mode)
+{
+    // Reading a record file, either summarizing it (scan) or playing its games again (rerun).
+    // Return value - ERROR_INVALID if the file can't be read or the mode is unknown, else ERROR_OK.
+
+    RecordMap map;
+
+    if ((strcmp(mode, "scan") != 0 && strcmp(mode, "rerun") != 0) || mapRecordFile(&map, path) != ERROR_OK)
+        return ERROR_INVALID;
+
+    if (strcmp(mode, "scan") == 0)
+        scanRecords(&map);
+    else
+        rerunRecords(&map);
+
+    unmapRecordFile(&map);
+    return ERROR_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Event tracing /////////////////////////////////////////////////////////
+
+errorCode openTracer(Tracer* tracer, char* path, int policy)
+{
+    // Opening the trace file and starting the drain thread.
+    // Tracer* tracer - Pointer to the tracer.
+    // char* path - The path of the trace file, it is overwritten.
+    // int policy - TRACE_DROP or TRACE_BLOCK.
+    // Return value - ERROR_INVALID if the file can't be opened or the thread can't be started, else ERROR_OK.
+
+    tracer->file = fopen(path, "w");
+    if (tracer->file == NULL)
+        return ERROR_INVALID;
+    fprintf(tracer->file, "game,move,player,action,card,hand\n");
+
+    tracer->ring = (TraceEvent*)malloc(sizeof(TraceEvent) * TRACE_RING_SIZE);
+    if (tracer->ring == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    tracer->policy = policy;
+    atomic_init(&tracer->head, 0);
+    atomic_init(&tracer->tail, 0);
+    atomic_init(&tracer->done, false);
+    tracer->cachedTail = 0;
+    tracer->games = 0;
+    tracer->move = 0;
+    tracer->dropped = 0;
+
+    if (thrd_create(&tracer->thread, traceDrainMain, tracer) != thrd_success) {
+        fclose(tracer->file);
+        free(tracer->ring);
+        return ERROR_INVALID;
+    }
+    return ERROR_OK;
+}
+
+void traceGameStart(GameInfo* info)
+{
+    // Starting a new game in the trace, the actions that follow belong to it.
+
+    Tracer* tracer = info->tracer;
+
+    if (tracer == NULL)
+        return;
+    tracer->games++;
+    tracer->move = 0;
+}
+
+void traceAction(GameInfo* info, Player* player, token tokenType, Card card)
+{
+    // Pushing an action of a player to the ring of the tracer, called only by the game thread.
+    // GameInfo* info - Pointer to the info of the game, nothing is done when it has no tracer.
+    // Player* player - Pointer to the player, his hand is already changed by the action.
+    // token tokenType - The token of the card placed, TOKEN_FROM_DEC for drawing a card, NO_TOKEN for picking a colour.
+    // Card card - The card placed or drawn, or the top card after picking a colour.
+
+    Tracer* tracer = info->tracer;
+    TraceEvent* event;
+    size_t head;
+
+    if (tracer == NULL)
+        return;
+
+    head = atomic_load_explicit(&tracer->head, memory_order_relaxed);
+    if (head - tracer->cachedTail == TRACE_RING_SIZE) {
+        tracer->cachedTail = atomic_load_explicit(&tracer->tail, memory_order_acquire);
+        while (head - tracer->cachedTail == TRACE_RING_SIZE) {
+            if (tracer->policy == TRACE_DROP) {
+                tracer->dropped++;
+                tracer->move++;
+                return;
+            }
+            thrd_yield();
+            tracer->cachedTail = atomic_load_explicit(&tracer->tail, memory_order_acquire);
+        }
+    }
+
+    event = &tracer->ring[head & (TRACE_RING_SIZE - 1)];
+    event->game = tracer->games - 1;
+    event->move = tracer->move++;
+    event->handSize = (unsigned short)player->handSize;
+    event->player = (unsigned char)(player - info->players);
+    event->token = (unsigned char)tokenType;
+    event->card = card;
+    atomic_store_explicit(&tracer->head, head + 1, memory_order_release);
+}
+
+size_t formatTraceEvent(char* text, TraceEvent* event)
+{
+    // Writing the line of an event of the trace, the numbers are written by hand since the drain thread writes millions of them.
+    // char* text - The line is written here, it needs room for TRACE_LINE_MAX characters.
+    // TraceEvent* event - Pointer to the event.
+    // Return value - The length of the line.
+
+    uint32_t numbers[2] = { event->game, event->move };
+    const char* action = event->token == TOKEN_FROM_DEC ? "draw," : event->token == NO_TOKEN ? "color," : "place,";
+    const char* kind = cardTypeStr[CARD_KIND(event->card)];
+    char digits[10];
+    size_t length = 0;
+    uint32_t num;
+    int i, j;
+
+    for (i = 0; i < 2; i++) {
+        num = numbers[i];
+        j = sizeof(digits);
+        do {
+            digits[--j] = (char)('0' + num % 10);
+            num /= 10;
+        } while (num > 0);
+        memcpy(text + length, digits + j, sizeof(digits) - j);
+        length += sizeof(digits) - j;
+        text[length++] = ',';
+    }
+
+    num = event->player;
+    if (num >= 100)
+        text[length++] = (char)('0' + num / 100);
+    if (num >= 10)
+        text[length++] = (char)('0' + num / 10 % 10);
+    text[length++] = (char)('0' + num % 10);
+    text[length++] = ',';
+
+    while (*action != '\0')
+        text[length++] = *action++;
+    while (*kind != '\0')
+        text[length++] = *kind++;
+    if (CARD_COLOR(event->card) != NO_COLOR) {
+        text[length++] = ' ';
+        text[length++] = colourChar[CARD_COLOR(event->card)];
+    }
+    text[length++] = ',';
+
+    num = event->handSize;
+    j = sizeof(digits);
+    do {
+        digits[--j] = (char)('0' + num % 10);
+        num /= 10;
+    } while (num > 0);
+    memcpy(text + length, digits + j, sizeof(digits) - j);
+    length += sizeof(digits) - j;
+    text[length++] = '\n';
+
+    return length;
+}
+
+int traceDrainMain(void* arg)
+{
+    // The drain thread, writing the events of the ring to the file in batches until the tracer is closed.
+    // void* arg - Pointer to the tracer.
+    // Return value - 0.
+
+    Tracer* tracer = (Tracer*)arg;
+    struct timespec idle = { 0, TRACE_IDLE_NS };
+    char* text = (char*)malloc(TRACE_DRAIN_BATCH * TRACE_LINE_MAX);
+    TraceEvent* event;
+    size_t head, tail, count, i, length;
+    bool done = false;
+
+    if (text == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+
+    for (;;) {
+        head = atomic_load_explicit(&tracer->head, memory_order_acquire);
+        tail = atomic_load_explicit(&tracer->tail, memory_order_relaxed);
+        if (head == tail) {
+            // The ring is read once more after done is seen, the last events are pushed before it is set.
+            if (done)
+                break;
+            done = atomic_load_explicit(&tracer->done, memory_order_acquire);
+            if (!done)
+                thrd_sleep(&idle, NULL);
+            continue;
+        }
+
+        count = head - tail < TRACE_DRAIN_BATCH ? head - tail : TRACE_DRAIN_BATCH;
+        length = 0;
+        for (i = 0; i < count; i++) {
+            event = &tracer->ring[(tail + i) & (TRACE_RING_SIZE - 1)];
+            length += formatTraceEvent(text + length, event);
+        }
+        // The slots are handed back before the write, the text holds a copy of them.
+        atomic_store_explicit(&tracer->tail, tail + count, memory_order_release);
+        fwrite(text, 1, length, tracer->file);
+    }
+
+    free(text);
+    return 0;
+}
+
+void closeTracer(Tracer* tracer)
+{
+    // Waiting for the drain thread to write every event, closing the file and printing how many events were traced.
+
+    atomic_store_explicit(&tracer->done, true, memory_order_release);
+    thrd_join(tracer->thread, NULL);
+    fclose(tracer->file);
+    free(tracer->ring);
+    tracer->ring = NULL;
+
+    printf("Traced %lld events of %lu games, %lld dropped\n", (long long)atomic_load(&tracer->head),
+        (unsigned long)tracer->games, tracer->dropped);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Instrumentation ///////////////////////////////////////////////////////
+
+#if defined(TAKI_INSTRUMENT)
+const char* instrCounterNames[INSTR_COUNTERS] = { "deck_reallocs", "taki_runs", "taki_run_cards", "retries" };
+const char* instrTimerNames[INSTR_TIMERS] = { "render", "decide", "rules" };
+
+_Thread_local Instrumentation instrLocal; // The counters of the thread
+Instrumentation instrTotal; // The counters of the threads that ended, under instrLock
+mtx_t instrLock;
+once_flag instrOnce = ONCE_FLAG_INIT;
+
+uint64_t instrNanoseconds()
+{
+    // The clock of the timers where there is no cycle counter.
+
+    struct timespec now;
+
+    timespec_get(&now, TIME_UTC);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+void initInstrLock()
+{
+    mtx_init(&instrLock, mtx_plain);
+}
+
+void mergeInstrumentation()
+{
+    // Adding the counters of the calling thread to the total and clearing them, called when a thread ends.
+
+    int i;
+
+    call_once(&instrOnce, initInstrLock);
+    mtx_lock(&instrLock);
+    for (i = 0; i < INSTR_COUNTERS; i++)
+        instrTotal.counts[i] += instrLocal.counts[i];
+    for (i = 0; i < INSTR_TIMERS; i++) {
+        instrTotal.calls[i] += instrLocal.calls[i];
+        instrTotal.cycles[i] += instrLocal.cycles[i];
+    }
+    mtx_unlock(&instrLock);
+    memset(&instrLocal, 0, sizeof(instrLocal));
+}
+
+void dumpInstrumentation(const char* path)
+{
+    // Printing the summary of the counters and the timers, and writing it as JSON to the file.
+    // The counters of the calling thread are merged first, the threads that ended are already in the total.
+    // const char* path - The path of the JSON file.
+
+    FILE* file;
+    uint64_t totalCycles = 0;
+    double averageRun;
+    int i;
+
+    mergeInstrumentation();
+    for (i = 0; i < INSTR_TIMERS; i++)
+        totalCycles += instrTotal.cycles[i];
+    averageRun = instrTotal.counts[INSTR_TAKI_RUNS] > 0
+        ? (double)instrTotal.counts[INSTR_TAKI_CARDS] / instrTotal.counts[INSTR_TAKI_RUNS] : 0.0;
+
+    printf("\n************ Instrumentation ************\n"
+        "Counter        | Count\n");
+    for (i = 0; i < INSTR_COUNTERS; i++)
+        printf("%14s | %lld\n", instrCounterNames[i], instrTotal.counts[i]);
+    printf("Average TAKI run: %.2f cards\n", averageRun);
+
+    printf("\nTimer  | Calls        | %-5s total    | Per call | Share\n", INSTR_CLOCK_NAME);
+    for (i = 0; i < INSTR_TIMERS; i++) {
+        printf("%6s | %12lld | %14llu | %8.0f | %5.1f%%\n", instrTimerNames[i], instrTotal.calls[i],
+            (unsigned long long)instrTotal.cycles[i], instrTotal.calls[i] > 0 ? (double)instrTotal.cycles[i] / instrTotal.calls[i] : 0.0,
+            totalCycles > 0 ? 100.0 * instrTotal.cycles[i] / totalCycles : 0.0);
+    }
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Error: Could not open %s !\n", path);
+        return;
+    }
+    fprintf(file, "{\n  \"clock\": \"%s\",\n  \"counters\": {", INSTR_CLOCK_NAME);
+    for (i = 0; i < INSTR_COUNTERS; i++)
+        fprintf(file, "%s\n    \"%s\": %lld", i > 0 ? "," : "", instrCounterNames[i], instrTotal.counts[i]);
+    fprintf(file, "\n  },\n  \"average_taki_run\": %.4f,\n  \"timers\": {", averageRun);
+    for (i = 0; i < INSTR_TIMERS; i++) {
+        fprintf(file, "%s\n    \"%s\": { \"calls\": %lld, \"total\": %llu }", i > 0 ? "," : "", instrTimerNames[i],
+            instrTotal.calls[i], (unsigned long long)instrTotal.cycles[i]);
+    }
+    fprintf(file, "\n  }\n}\n");
+    fclose(file);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Transposition table ///////////////////////////////////////////////////
+
+void initTranspositionTable(TranspositionTable* table, int bits)
+{
+    // Allocating an empty table of 2^bits entries.
+
+    table->entries = (TableEntry*)calloc((size_t)1 << bits, sizeof(TableEntry));
+    if (table->entries == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    table->mask = ((uint64_t)1 << bits) - 1;
+}
+
+void freeTranspositionTable(TranspositionTable* table)
+{
+    free(table->entries);
+    table->entries = NULL;
+}
+
+bool probeTable(TranspositionTable* table, uint64_t key, uint32_t* playouts, uint32_t* wins)
+{
+    // Looking up the playouts of a key, safe while other threads write the table.
+    // uint32_t* playouts, uint32_t* wins - Filled with the entry when it is found.
+    // Return value - true if the table holds the key.
+
+    TableEntry* entry = &table->entries[key & table->mask];
+    uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+
+    if ((check ^ data) != key || data == 0)
+        return false;
+    *playouts = (uint32_t)data;
+    *wins = (uint32_t)(data >> 32);
+    return true;
+}
+
+void updateTable(TranspositionTable* table, uint64_t key, bool won)
+{
+    // Adding a playout to the entry of a key, an entry of another key is replaced.
+    // Two threads adding to the same entry together may lose one of the playouts, the table is only a hint so it is not locked.
+
+    TableEntry* entry = &table->entries[key & table->mask];
+    uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+
+    if ((check ^ data) != key)
+        data = 0;
+    if ((uint32_t)data == UINT32_MAX)
+        return;
+    data += 1 + ((uint64_t)won << 32);
+    atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+    atomic_store_explicit(&entry->check, key ^ data, memory_order_relaxed);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// ISMCTS player /////////////////////////////////////////////////////////
+
+IsmctsBot* newIsmctsBot(double budget, int numOfThreads, uint64_t seed)
+{
+    // Creating the context of an ISMCTS player, the search threads are allocated on its first move.
+    // double budget - The time of each move in seconds.
+    // int numOfThreads - The amount of threads searching each move.
+    // uint64_t seed - Seeds the playouts, every thread gets its own stream out of it.
+    // Return value - The new context.
+
+    IsmctsBot* bot = (IsmctsBot*)calloc(1, sizeof(IsmctsBot));
+
+    if (bot == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    bot->budget = budget;
+    bot->numOfThreads = numOfThreads;
+    seedRng(&bot->rng, seed);
+
+    return bot;
+}
+
+void freeIsmctsBot(IsmctsBot* bot)
+{
     int i;
 
-    for (i = 0; i < info->numOfPlayers; i++)
-        players[i].deck = deckRealloc(&players[i], 0);
+    if (bot->workers != NULL) {
+        for (i = 0; i < bot->numOfThreads; i++) {
+            freeArena(&bot->workers[i].info.arena);
+            freeDeck(&bot->workers[i].info.deck);
+            free(bot->workers[i].players);
+            free(bot->workers[i].nodes);
+        }
+        free(bot->workers);
+        freeTranspositionTable(&bot->table);
+    }
+    free(bot);
+}
+
+void prepareSearchWorkers(IsmctsBot* bot, int numOfPlayers)
+{
+    // Allocating the search threads on the first move, and their players whenever the amount of players changes.
+
+    SearchWorker* worker;
+    int i;
+
+    if (bot->workers == NULL) {
+        bot->workers = (SearchWorker*)calloc(bot->numOfThreads, sizeof(SearchWorker));
+        if (bot->workers == NULL) {
+            printf("Error: Could not allocate memory !\n");
+            exit(1);
+        }
+        initTranspositionTable(&bot->table, ISMCTS_TABLE_BITS);
+
+        for (i = 0; i < bot->numOfThreads; i++) {
+            worker = &bot->workers[i];
+
+            worker->bot = bot;
+            worker->info.headless = true;
+            initHistogram(&worker->info.histogram);
+            initArena(&worker->info.arena, ARENA_INIT_CAPACITY);
+            worker->strategy.pickCard = searchPickCard;
+            worker->strategy.pickColor = searchPickColor;
+            worker->strategy.context = worker;
+            worker->nodes = (SearchNode*)malloc(sizeof(SearchNode) * ISMCTS_MAX_NODES);
+            if (worker->nodes == NULL) {
+                printf("Error: Could not allocate memory !\n");
+                exit(1);
+            }
+
+            // Jumping gives every thread a stream that never overlaps the streams of the others.
+            jumpRng(&bot->rng);
+            worker->rng = bot->rng;
+        }
+    }
+
+    if (bot->numOfPlayers != numOfPlayers) {
+        for (i = 0; i < bot->numOfThreads; i++) {
+            worker = &bot->workers[i];
 
-    sortHistogram(info);
-    printHistogram(info);
+            free(worker->players);
+            worker->players = (Player*)malloc(sizeof(Player) * numOfPlayers);
+            checkPlayerAlloc(worker->players);
+            initBotPlayers(worker->players, numOfPlayers, &worker->strategy);
+        }
+        bot->numOfPlayers = numOfPlayers;
+    }
 }
 
-int main()
+int addSearchNode(SearchWorker* worker, int parent, int action, int player)
 {
-    Player* players = NULL;
-    GameInfo info = { 0 };
+    // Adding a child to a node of the tree of the worker.
+    // Return value - The index of the new node, or NO_NODE if the pool is full.
+
+    SearchNode* node;
+
+    if (worker->numOfNodes == ISMCTS_MAX_NODES)
+        return NO_NODE;
+
+    node = &worker->nodes[worker->numOfNodes];
+    node->action = action;
+    node->player = player;
+    node->visits = 0;
+    node->avail = 1;
+    node->wins = 0;
+    node->firstChild = NO_NODE;
+    node->nextSibling = NO_NODE;
+    if (parent != NO_NODE) {
+        node->nextSibling = worker->nodes[parent].firstChild;
+        worker->nodes[parent].firstChild = worker->numOfNodes;
+    }
+    return worker->numOfNodes++;
+}
 
-    setSeed();
-    welcomeMsg();
+int collectActions(GameInfo* info, Player* player, int actions[], int choices[])
+{
+    // Collecting the legal actions of a card decision, equal cards in the hand are the same action.
+    // int actions[] - Filled with the actions, the last one is always drawing a card. Must fit CARD_CODES + 1 actions.
+    // int choices[] - Filled with the choice (as returned by pickCard) of each action.
+    // Return value - The amount of actions.
+
+    uint64_t seen[CARD_CODES / 64] = { 0 };
+    uint64_t mask;
+    int base, numOfCards, i, count = 0;
+    Card card;
+
+    for (base = 0; base < player->handSize; base += MASK_CARDS) {
+        numOfCards = player->handSize - base < MASK_CARDS ? player->handSize - base : MASK_CARDS;
+        for (mask = legalMask(info, player->deck + base, numOfCards); mask != 0; mask &= mask - 1) {
+            i = base + lowestBit(mask);
+            card = player->deck[i];
+            if ((seen[card / 64] >> (card % 64)) & 1)
+                continue;
+            seen[card / 64] |= (uint64_t)1 << (card % 64);
+            actions[count] = card;
+            choices[count++] = i + 1;
+        }
+    }
+    actions[count] = ACTION_DRAW;
+    choices[count++] = 0;
 
-    setNumOfPlayers(&info.numOfPlayers);
-    players = (Player*)malloc(sizeof(Player) * info.numOfPlayers);
-    checkPlayerAlloc(players);
+    return count;
+}
 
-    initPlayers(players, info.numOfPlayers);
-    initGameInfo(&info);
+int selectAction(SearchWorker* worker, int player, int actions[], int numOfActions)
+{
+    // Choosing the action of the player at the current node of the playout, and moving the playout down the tree.
+    // An action that was never tried is expanded and the rest of the playout leaves the tree,
+    // otherwise the child with the best UCB score is chosen, counting only the playouts in which it was available.
+    // A new node starts with the playouts the transposition table holds for its position and action, up to ISMCTS_TABLE_PRIOR.
+    // SearchWorker* worker - The worker playing the playout.
+    // int player - The index of the player taking the action.
+    // int actions[] - The legal actions.
+    // int numOfActions - The amount of legal actions.
+    // Return value - The index of the chosen action.
+
+    SearchNode* nodes = worker->nodes;
+    int parent = worker->current, child, bestChild = NO_NODE;
+    int i, best = 0, untried = 0, numOfUntried = 0;
+    uint32_t playouts, wins;
+    uint64_t key;
+    double score, bestScore = -1;
+
+    for (i = 0; i < numOfActions; i++) {
+        for (child = nodes[parent].firstChild; child != NO_NODE && nodes[child].action != actions[i]; child = nodes[child].nextSibling)
+            ;
+        if (child == NO_NODE) {
+            // Choosing uniformly between the untried actions.
+            if (getRandInRange(&worker->rng, ++numOfUntried) == 1)
+                untried = i;
+            continue;
+        }
 
-    gameLoop(&info, players);
-    exitGame(&info, players);
+        nodes[child].avail++;
+        score = (double)nodes[child].wins / nodes[child].visits
+            + ISMCTS_EXPLORATION * sqrt(log((double)nodes[child].avail) / nodes[child].visits);
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+            bestChild = child;
+        }
+    }
 
-    free(players);
-    players = NULL;
+    key = gameHash(&worker->info) ^ zobristKey(ZOBRIST_ACTION | (uint64_t)actions[numOfUntried > 0 ? untried : best]);
+    if (numOfUntried > 0) {
+        best = untried;
+        bestChild = addSearchNode(worker, parent, actions[best], player);
+        worker->current = NO_NODE;
+        if (bestChild != NO_NODE && probeTable(&worker->bot->table, key, &playouts, &wins)) {
+            // The wins are scaled with the playouts, so the prior keeps the rate of the entry.
+            if (playouts > ISMCTS_TABLE_PRIOR) {
+                wins = (uint32_t)((uint64_t)wins * ISMCTS_TABLE_PRIOR / playouts);
+                playouts = ISMCTS_TABLE_PRIOR;
+            }
+            nodes[bestChild].visits = (int)playouts;
+            nodes[bestChild].wins = (int)wins;
+            worker->tableHits++;
+        }
+    }
+    else {
+        worker->current = bestChild;
+    }
+
+    if (bestChild != NO_NODE && worker->pathLength < ISMCTS_MAX_DEPTH) {
+        worker->pathKeys[worker->pathLength] = key;
+        worker->path[worker->pathLength++] = bestChild;
+    }
+    else
+        worker->current = NO_NODE;
+
+    return best;
+}
+
+int searchPickCard(GameInfo* info, Player* player, void* context)
+{
+    // The strategy of every player of a playout, walking down the tree and playing the greedy moves once it left it,
+    // greedy playouts judge a move much better than random ones for about the same cost.
+    // Return value - 0 for drawing a card or 1 - handSize.
+
+    SearchWorker* worker = (SearchWorker*)context;
+    int actions[CARD_CODES + 1], choices[CARD_CODES + 1];
+    int numOfActions;
+
+    if (worker->current == NO_NODE)
+        return greedyPickCard(info, player, NULL);
+
+    numOfActions = collectActions(info, player, actions, choices);
+    return choices[selectAction(worker, (int)(player - info->players), actions, numOfActions)];
+}
+
+int searchPickColor(GameInfo* info, Player* player, void* context)
+{
+    // Return value - COLOR_Y - COLOR_G
+
+    SearchWorker* worker = (SearchWorker*)context;
+    int actions[COLOR_G];
+    int i;
+
+    if (worker->current == NO_NODE)
+        return greedyPickColor(info, player, NULL);
+
+    for (i = 0; i < COLOR_G; i++)
+        actions[i] = ACTION_COLOR + COLOR_Y + i;
+    return COLOR_Y + selectAction(worker, (int)(player - info->players), actions, COLOR_G);
+}
+
+void determinize(SearchWorker* worker)
+{
+    // Restoring the searched position into the game of the worker, dealing random hands to the opponents.
+    // When each card is made at random, the only thing known about a hidden hand is its size,
+    // and a random hand of that size is a sample of what the opponent may hold.
+    // With a finite deck the hidden cards are the draw pile and the hands of the opponents: they are put together
+    // at the end of the draw pile, shuffled, and the hands are dealt back from it.
+
+    GameInfo* info = &worker->info;
+    Deck* deck = &info->deck;
+    Player* player;
+    int i, j;
+
+    restoreGame(info, worker->players, &worker->bot->root);
+    seedGame(info, nextRand(&worker->rng));
+
+    if (deck->cards != NULL) {
+        for (i = 0; i < info->numOfPlayers; i++) {
+            if (i == worker->bot->rootPlayer)
+                continue;
+            memcpy(deck->cards + deck->drawCount, worker->players[i].deck, worker->players[i].handSize);
+            deck->drawCount += worker->players[i].handSize;
+        }
+        shuffleCards(&info->rng, deck->cards, deck->drawCount);
+    }
+
+    for (i = 0; i < info->numOfPlayers; i++) {
+        if (i == worker->bot->rootPlayer)
+            continue;
+        player = &worker->players[i];
+        if (deck->cards != NULL) {
+            deck->drawCount -= player->handSize;
+            memcpy(player->deck, deck->cards + deck->drawCount, player->handSize);
+        }
+        else {
+            for (j = 0; j < player->handSize; j++)
+                drawCard(info, &player->deck[j]);
+        }
+        player->handHash = hashHand(player);
+    }
+}
+
+int searchWorkerMain(void* arg)
+{
+    // The main function of each search thread, playing playouts until the time of the move is up.
+
+    SearchWorker* worker = (SearchWorker*)arg;
+    IsmctsBot* bot = worker->bot;
+    int i, winner;
+
+    worker->numOfNodes = 0;
+    worker->playouts = 0;
+    worker->tableHits = 0;
+    addSearchNode(worker, NO_NODE, NO_NODE, NO_NODE);
+
+    // At least one playout is played, so the root always has a child to choose.
+    do {
+        determinize(worker);
+        worker->current = 0;
+        worker->pathLength = 0;
+
+        winner = gameLoop(&worker->info, worker->players);
+
+        worker->nodes[0].visits++;
+        for (i = 0; i < worker->pathLength; i++) {
+            worker->nodes[worker->path[i]].visits++;
+            if (worker->nodes[worker->path[i]].player == winner)
+                worker->nodes[worker->path[i]].wins++;
+            updateTable(&bot->table, worker->pathKeys[i], worker->nodes[worker->path[i]].player == winner);
+        }
+        worker->playouts++;
+    } while (wallSeconds() < bot->deadline);
+
+    INSTR_MERGE();
+    return 0;
+}
+
+int ismctsSearch(IsmctsBot* bot, GameInfo* info, Player* player)
+{
+    // Searching a decision of the player on all the search threads, and choosing the action visited the most.
+    // The phase of the game tells which decision it is, the playouts continue from it.
+    // IsmctsBot* bot - The context of the player.
+    // GameInfo* info - The game, it isn't changed.
+    // Player* player - The player making the decision.
+    // Return value - The chosen action, or NO_ACTION if the game is too big to be searched.
+
+    thrd_t threads[MAX_THREADS];
+    long long visits[ACTION_RANGE] = { 0 };
+    long long playouts = 0, tableHits = 0;
+    SearchWorker* worker;
+    int i, child, best = ACTION_DRAW;
+    double start = wallSeconds(), seconds;
+
+    if (snapshotGame(info, info->players, &bot->root) != ERROR_OK)
+        return NO_ACTION;
+    prepareSearchWorkers(bot, info->numOfPlayers);
+    bot->rootPlayer = (int)(player - info->players);
+    for (i = 0; i < bot->numOfThreads; i++) {
+        bot->workers[i].info.deckKinds = info->deckKinds;
+        bot->workers[i].info.numOfDeckKinds = info->numOfDeckKinds;
+    }
+    bot->deadline = start + bot->budget;
+
+    for (i = 1; i < bot->numOfThreads; i++) {
+        if (thrd_create(&threads[i], searchWorkerMain, &bot->workers[i]) != thrd_success) {
+            printf("Error: Could not create a thread !\n");
+            exit(1);
+        }
+    }
+    searchWorkerMain(&bot->workers[0]);
+    for (i = 1; i < bot->numOfThreads; i++)
+        thrd_join(threads[i], NULL);
+
+    // Merging the trees of the threads at the root.
+    for (i = 0; i < bot->numOfThreads; i++) {
+        worker = &bot->workers[i];
+
+        playouts += worker->playouts;
+        tableHits += worker->tableHits;
+        for (child = worker->nodes[0].firstChild; child != NO_NODE; child = worker->nodes[child].nextSibling)
+            visits[worker->nodes[child].action] += worker->nodes[child].visits;
+    }
+    for (i = 0; i < ACTION_RANGE; i++) {
+        if (visits[i] > visits[best])
+            best = i;
+    }
+
+    seconds = wallSeconds() - start;
+    bot->moves++;
+    bot->playouts += playouts;
+    bot->tableHits += tableHits;
+    bot->seconds += seconds;
+    if (!info->headless)
+        printf("%s searched %lld playouts in %.2f seconds (%.0f playouts/sec, %lld table hits)\n",
+            player->name, playouts, seconds, seconds > 0 ? playouts / seconds : 0.0, tableHits);
 
+    return best;
+}
+
+int ismctsPickCard(GameInfo* info, Player* player, void* context)
+{
+    // Strategy searching the card to place with ISMCTS.
+    // Return value - 0 for drawing a card or 1 - handSize.
+
+    int actions[CARD_CODES + 1], choices[CARD_CODES + 1];
+    int i, action;
+
+    // Drawing a card is the only choice, nothing to search.
+    if ((player->counts != NULL && player->handSize > MASK_CARDS && countLegalCards(info, player->counts) == 0)
+        || collectActions(info, player, actions, choices) == 1)
+        return 0;
+
+    action = ismctsSearch((IsmctsBot*)context, info, player);
+    if (action == NO_ACTION)
+        return greedyPickCard(info, player, NULL);
+    for (i = 1; i <= player->handSize; i++) {
+        if (player->deck[i - 1] == action && validateMove(info, player, i) == ERROR_OK)
+            return i;
+    }
     return 0;
 }
+
+int ismctsPickColor(GameInfo* info, Player* player, void* context)
+{
+    // Strategy searching the colour of a COLOR card with ISMCTS.
+    // Return value - COLOR_Y - COLOR_G
+
+    int action = ismctsSearch((IsmctsBot*)context, info, player);
+
+    if (action == NO_ACTION)
+        return greedyPickColor(info, player, NULL);
+    return action - ACTION_COLOR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Benchmark /////////////////////////////////////////////////////////////
+
+// A deck where about a third of the cards are TAKI cards, for long TAKI runs.
+const unsigned char takiHeavyKinds[] = {
+    KIND_1, KIND_2, KIND_3, KIND_4, KIND_5, KIND_6, KIND_7, KIND_8, KIND_9,
+    KIND_PLUS, KIND_STOP, KIND_CHANGE_DIR, KIND_CHANGE_COL,
+    KIND_TAKI, KIND_TAKI, KIND_TAKI, KIND_TAKI, KIND_TAKI, KIND_TAKI
+};
+
+const BenchWorkload benchWorkloads[] = {
+    { "2p", 2, 1, NULL, 0, 0 },
+    { "4p", 4, 1, NULL, 0, 0 },
+    { "8p", 8, 1, NULL, 0, 0 },
+    { "4p-taki-heavy", 4, 1, takiHeavyKinds, sizeof(takiHeavyKinds), 0 },
+    { "2p-long", 2, 20, NULL, 0, 32 }
+};
+
+const char* benchFunctionNames[BENCH_FUNCTIONS] = {
+    "validateMove", "step", "takiRun", "deckRealloc", "displayCards"
+};
+
+uint64_t nowNanos()
+{
+    // Return value - The wall clock time in nanoseconds.
+
+    struct timespec now;
+
+    timespec_get(&now, TIME_UTC);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+double timerOverhead()
+{
+    // Return value - The median time of reading the clock twice, subtracted from every timed call.
+
+    double samples[1001];
+    uint64_t start;
+    int i;
+
+    for (i = 0; i < 1001; i++) {
+        start = nowNanos();
+        samples[i] = (double)(nowNanos() - start);
+    }
+    qsort(samples, 1001, sizeof(double), compareDoubles);
+    return samples[500];
+}
+
+int benchPickCard(GameInfo* info, Player* player, void* context)
+{
+    // The strategy of the benchmark, greedy except for the hoarding players.
+    // Return value - 0 for drawing a card or 1 - handSize.
+
+    BenchContext* bench = (BenchContext*)context;
+    BenchPosition* position;
+    int seat = (int)(player - info->players), choice;
+
+    if (!bench->full[seat] && player->handSize < bench->workload->hoardHand)
+        choice = 0;
+    else {
+        bench->full[seat] = true;
+        choice = greedyPickCard(info, player, NULL);
+    }
+
+    bench->moves++;
+    if (bench->sampling && bench->moves % BENCH_SAMPLE_EVERY == 0 && info->phase == PHASE_PICK_CARD
+        && bench->numOfPositions < BENCH_POSITIONS) {
+        position = &bench->positions[bench->numOfPositions];
+        if (snapshotGame(info, info->players, &position->snapshot) == ERROR_OK) {
+            position->choice = choice;
+            bench->numOfPositions++;
+        }
+    }
+    return choice;
+}
+
+int benchPickColor(GameInfo* info, Player* player, void* context)
+{
+    (void)context;
+    return greedyPickColor(info, player, NULL);
+}
+
+void printBenchFunction(const char* name, double* samples, int numOfSamples, bool last)
+{
+    // Printing the timings of a function as a JSON object, the samples are sorted for the percentiles.
+
+    double sum = 0, mean;
+    int i;
+
+    qsort(samples, numOfSamples, sizeof(double), compareDoubles);
+    for (i = 0; i < numOfSamples; i++)
+        sum += samples[i];
+    mean = numOfSamples > 0 ? sum / numOfSamples : 0.0;
+
+    printf("        { \"name\": \"%s\", \"samples\": %d", name, numOfSamples);
+    if (numOfSamples > 0) {
+        printf(", \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, \"p999_ns\": %.1f, \"max_ns\": %.1f, \"calls_per_sec\": %.0f",
+            mean, samples[(numOfSamples - 1) / 2], samples[(int)((numOfSamples - 1) * 0.9)],
+            samples[(int)((numOfSamples - 1) * 0.99)], samples[(int)((numOfSamples - 1) * 0.999)], samples[numOfSamples - 1],
+            mean > 0 ? 1e9 / mean : 0.0);
+    }
+    printf(" }%s\n", last ? "" : ",");
+}
+
+void restoreBenchBatch(BenchContext* bench, int first)
+{
+    // Restoring the games of the batch from the positions starting at first.
+
+    int k;
+
+    for (k = 0; k < BENCH_BATCH; k++)
+        restoreGame(&bench->batch[k], bench->batchPlayers[k], &bench->positions[first + k].snapshot);
+}
+
+void timeBenchFunctions(BenchContext* bench, Frame* frame, double overhead)
+{
+    // Timing each function in the positions kept from a workload.
+    // The calls are timed BENCH_BATCH at a time, each on its own restored game, so every sample is the mean of a batch.
+    // validateMove is timed for every choice of the hand, displayCards for every card of the hand.
+    // step is timed with the choice of the position, and takiRun is the rest of the turn after a TAKI card, played greedy.
+
+    static double samples[BENCH_FUNCTIONS][BENCH_POSITIONS / BENCH_BATCH * BENCH_REPEATS];
+    int counts[BENCH_FUNCTIONS] = { 0 };
+    volatile int sink = 0;
+    Player* player[BENCH_BATCH];
+    GameInfo* info;
+    uint64_t start, elapsed;
+    int first, r, k, c, f, calls;
+
+#define BENCH_SAMPLE(function, calls) \
+    elapsed = nowNanos() - start; \
+    samples[function][counts[function]++] = ((double)elapsed > overhead ? (double)elapsed - overhead : 0.0) / (calls)
+
+    for (first = 0; first + BENCH_BATCH <= bench->numOfPositions; first += BENCH_BATCH) {
+        for (r = 0; r < BENCH_REPEATS; r++) {
+            restoreBenchBatch(bench, first);
+            for (k = 0; k < BENCH_BATCH; k++)
+                player[k] = &bench->batchPlayers[k][bench->batch[k].currentlyPlaying];
+
+            calls = 0;
+            start = nowNanos();
+            for (k = 0; k < BENCH_BATCH; k++) {
+                for (c = 0; c <= player[k]->handSize; c++)
+                    sink += validateMove(&bench->batch[k], player[k], c);
+                calls += player[k]->handSize + 1;
+            }
+            BENCH_SAMPLE(0, calls);
+
+            calls = 0;
+            frame->length = 0;
+            start = nowNanos();
+            for (k = 0; k < BENCH_BATCH; k++) {
+                for (c = 0; c < player[k]->handSize; c++)
+                    displayCards(frame, &player[k]->deck[c]);
+                calls += player[k]->handSize;
+            }
+            BENCH_SAMPLE(4, calls > 0 ? calls : 1);
+
+            start = nowNanos();
+            for (k = 0; k < BENCH_BATCH; k++)
+                sink += step(&bench->batch[k], bench->positions[first + k].choice);
+            BENCH_SAMPLE(1, BENCH_BATCH);
+
+            // takiRun is timed only in the games whose move started a TAKI run.
+            calls = 0;
+            for (k = 0; k < BENCH_BATCH; k++)
+                calls += bench->batch[k].phase == PHASE_TAKI_PICK;
+            if (calls > 0) {
+                start = nowNanos();
+                for (k = 0; k < BENCH_BATCH; k++) {
+                    info = &bench->batch[k];
+                    while (info->phase == PHASE_TAKI_PICK)
+                        step(info, greedyPickCard(info, player[k], NULL));
+                }
+                BENCH_SAMPLE(2, calls);
+            }
+
+            restoreBenchBatch(bench, first);
+            start = nowNanos();
+            for (k = 0; k < BENCH_BATCH; k++)
+                player[k]->deck = deckRealloc(&bench->batch[k], player[k], player[k]->handCapacity * 2);
+            BENCH_SAMPLE(3, BENCH_BATCH);
+        }
+    }
+#undef BENCH_SAMPLE
+
+    for (f = 0; f < BENCH_FUNCTIONS; f++)
+        printBenchFunction(benchFunctionNames[f], samples[f], counts[f], f == BENCH_FUNCTIONS - 1);
+}
+
+void runBenchmark(int numOfGames, uint64_t seed)
+{
+    // Playing the fixed seed workloads and timing the core functions, the results are printed as JSON so two versions can be compared.
+    // int numOfGames - The amount of games of each workload, before its divisor.
+    // uint64_t seed - Game number i of each workload is played with the seed + i.
+
+    const int numOfWorkloads = sizeof(benchWorkloads) / sizeof(benchWorkloads[0]);
+    const BenchWorkload* workload;
+    Strategy strategy = { benchPickCard, benchPickColor, NULL };
+    BenchContext* bench = (BenchContext*)calloc(1, sizeof(BenchContext));
+    Player players[BENCH_MAX_PLAYERS];
+    GameInfo info = { 0 };
+    Frame frame;
+    uint64_t winners, start;
+    double seconds, overhead;
+    int w, k, game, games;
+
+    if (bench == NULL || (bench->positions = (BenchPosition*)malloc(sizeof(BenchPosition) * BENCH_POSITIONS)) == NULL) {
+        printf("Error: Could not allocate memory !\n");
+        exit(1);
+    }
+    strategy.context = bench;
+    info.headless = true;
+    initHistogram(&info.histogram);
+    initArena(&info.arena, ARENA_INIT_CAPACITY);
+    for (k = 0; k < BENCH_BATCH; k++) {
+        bench->batch[k].headless = true;
+        initHistogram(&bench->batch[k].histogram);
+        initArena(&bench->batch[k].arena, ARENA_INIT_CAPACITY);
+    }
+    initGlyphCache();
+    initFrame(&frame, 1);
+    overhead = timerOverhead();
+
+    printf("{\n  \"seed\": %llu,\n  \"timer_overhead_ns\": %.1f,\n  \"batch\": %d,\n  \"workloads\": [\n", (unsigned long long)seed, overhead, BENCH_BATCH);
+    for (w = 0; w < numOfWorkloads; w++) {
+        workload = &benchWorkloads[w];
+        games = numOfGames / workload->gamesDivisor > 0 ? numOfGames / workload->gamesDivisor : 1;
+
+        info.numOfPlayers = workload->numOfPlayers;
+        info.deckKinds = workload->deckKinds;
+        info.numOfDeckKinds = workload->numOfDeckKinds;
+        initBotPlayers(players, workload->numOfPlayers, &strategy);
+        bench->workload = workload;
+        for (k = 0; k < BENCH_BATCH; k++) {
+            bench->batch[k].deckKinds = workload->deckKinds;
+            bench->batch[k].numOfDeckKinds = workload->numOfDeckKinds;
+            initBotPlayers(bench->batchPlayers[k], workload->numOfPlayers, &strategy);
+        }
+
+        // Keeping positions from the first games, then timing the whole workload without keeping any.
+        bench->sampling = true;
+        bench->numOfPositions = 0;
+        for (game = 0; game < games && bench->numOfPositions < BENCH_POSITIONS; game++) {
+            memset(bench->full, 0, sizeof(bench->full));
+            playHeadlessGame(&info, players, seed + game);
+        }
+        bench->sampling = false;
+        bench->moves = 0;
+
+        winners = 0;
+        start = nowNanos();
+        for (game = 0; game < games; game++) {
+            memset(bench->full, 0, sizeof(bench->full));
+            winners = winners * 31 + playHeadlessGame(&info, players, seed + game);
+        }
+        seconds = (nowNanos() - start) / 1e9;
+
+        printf("    { \"name\": \"%s\", \"players\": %d, \"games\": %d, \"moves\": %lld, \"seconds\": %.3f, "
+            "\"games_per_sec\": %.0f, \"moves_per_sec\": %.0f, \"winners_hash\": \"%016llx\",\n      \"functions\": [\n",
+            workload->name, workload->numOfPlayers, games, bench->moves, seconds,
+            seconds > 0 ? games / seconds : 0.0, seconds > 0 ? bench->moves / seconds : 0.0, (unsigned long long)winners);
+        timeBenchFunctions(bench, &frame, overhead);
+        printf("      ] }%s\n", w == numOfWorkloads - 1 ? "" : ",");
+    }
+    printf("  ]\n}\n");
+
+    freeFrame(&frame);
+    freeArena(&info.arena);
+    freeDeck(&info.deck);
+    for (k = 0; k < BENCH_BATCH; k++) {
+        freeArena(&bench->batch[k].arena);
+        freeDeck(&bench->batch[k].deck);
+    }
+    free(bench->positions);
+    free(bench);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////// Self test /////////////////////////////////////////////////////////////
+
+errorCode checkLegalMask(GameInfo* info, Card* cards, int count)
+{
+    // Comparing the mask of the vector code with the rules checked card by card, the hand and the top are printed when they differ.
+    // Return value - ERROR_INVALID if the masks differ, else ERROR_OK.
+
+    uint64_t mask = legalMask(info, cards, count), expected = legalMaskScalar(info, cards, count);
+    int i;
+
+    if (mask == expected)
+        return ERROR_OK;
+
+    printf("legalMask differs for %d cards on %s %c (TAKI colour %c): %016llx instead of %016llx\n", count,
+        cardTypeStr[CARD_KIND(info->topCard)], colourChar[CARD_COLOR(info->topCard)], colourChar[info->takiColour],
+        (unsigned long long)mask, (unsigned long long)expected);
+    for (i = 0; i < count; i++)
+        printf(" %s%c", cardTypeStr[CARD_KIND(cards[i])], colourChar[CARD_COLOR(cards[i])]);
+    printf("\n");
+    return ERROR_INVALID;
+}
+
+errorCode runSelfTest(int numOfHands, uint64_t seed)
+{
+    // Checking legalMask against legalMaskScalar on random hands, with the rules of the rule set in use.
+    // The hand sizes go over 1 - MASK_CARDS in turn, so every size that is not a whole amount of vectors is checked.
+    // Every other hand is checked inside a TAKI run of a colour that differs from the top card, and every fourth hand
+    // holds a COLOR card.
+    // int numOfHands - The amount of hands.
+    // uint64_t seed - The seed of the hands.
+    // Return value - ERROR_INVALID if a mask differs, else ERROR_OK.
+
+    Card buffer[SELFTEST_MAX_OFFSET + MASK_CARDS];
+    GameInfo info = { 0 };
+    Rng rng;
+    Card* cards;
+    long long failed = 0, runs = 0, wilds = 0;
+    int hand, count, i;
+
+    seedRng(&rng, seed);
+    for (hand = 0; hand < numOfHands; hand++) {
+        count = hand % MASK_CARDS + 1;
+        cards = buffer + getRandInRange(&rng, SELFTEST_MAX_OFFSET) - 1;
+        for (i = 0; i < count; i++)
+            makePlayerCard(&rng, &cards[i], getRandInRange(&rng, CARDS_RANGE));
+        if (hand % 4 == 0) {
+            cards[getRandInRange(&rng, count) - 1] = MAKE_CARD(KIND_CHANGE_COL, NO_COLOR);
+            wilds++;
+        }
+
+        // The top card always has a colour, a COLOR card on top has the colour that was picked.
+        info.topCard = MAKE_CARD(getRandInRange(&rng, CARDS_RANGE) - 1, getRandInRange(&rng, COLOR_G));
+        info.takiColour = NO_COLOR;
+        if (hand % 2 == 1) {
+            info.takiColour = (unsigned char)((CARD_COLOR(info.topCard) + getRandInRange(&rng, COLOR_G - 1) - 1) % COLOR_G + 1);
+            runs++;
+        }
+
+        if (checkLegalMask(&info, cards, count) != ERROR_OK)
+            failed++;
+    }
+
+    printf("Checked legalMask on %d hands (%lld in a TAKI run of another colour, %lld with a COLOR card), %lld failed\n",
+        numOfHands, runs, wilds, failed);
+    return failed > 0 ? ERROR_INVALID : ERROR_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    RecordFile record;
+    RecordFile* recordTo = NULL;
+    GameOptions options;
+    Tracer tracer;
+    Tracer* traceTo = NULL;
+    char* statsPath = NULL;
+    int progressMs = 0;
+    RuleSet rules;
+    int policy;
+    int numOfGames = SIM_DEFAULT_GAMES, numOfPlayers = SIM_DEFAULT_PLAYERS;
+    char* strategyName = "random";
+    char defaultStrategies[] = "random,greedy";
+    uint64_t seed = (uint64_t)time(NULL);
+    errorCode result = ERROR_OK;
+
+    // Usage: --rules <file> [mode], plays the mode with the rules of the file, see parseRuleLine
+    defaultRuleSet(&rules);
+    if (argc > 2 && strcmp(argv[1], "--rules") == 0) {
+        if (loadRuleSet(&rules, argv[2]) != ERROR_OK)
+            return ERROR_INVALID;
+
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    compileRuleSet(&rules);
+
+    // Usage: --record <file> [mode], records every game played by the mode to the file
+    if (argc > 2 && strcmp(argv[1], "--record") == 0) {
+        if (openRecordFile(&record, argv[2]) != ERROR_OK) {
+            printf("Error: Could not open %s !\n", argv[2]);
+            return ERROR_INVALID;
+        }
+        recordTo = &record;
+
+        // Dropping the two arguments, the name of the program stays first.
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    // Usage: --trace <file> [drop | block] [mode], writes every action of the games played by the mode to the file
+    if (argc > 2 && strcmp(argv[1], "--trace") == 0) {
+        policy = argc > 3 && strcmp(argv[3], "block") == 0 ? TRACE_BLOCK : TRACE_DROP;
+        if (openTracer(&tracer, argv[2], policy) != ERROR_OK) {
+            printf("Error: Could not open %s !\n", argv[2]);
+            return ERROR_INVALID;
+        }
+        traceTo = &tracer;
+
+        // Dropping the arguments, the policy too when it is given.
+        if (argc > 3 && (strcmp(argv[3], "drop") == 0 || strcmp(argv[3], "block") == 0)) {
+            argv[3] = argv[0];
+            argv += 3;
+            argc -= 3;
+        }
+        else {
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+        }
+    }
+
+    // Usage: --stats <file> [mode], writes the statistics of the games played by the mode to the file, as CSV for a .csv file else as JSON
+    if (argc > 2 && strcmp(argv[1], "--stats") == 0) {
+        statsPath = argv[2];
+
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    // Usage: --progress [ms] --tournament ..., prints the results of the tournament so far every interval while it is played
+    if (argc > 1 && strcmp(argv[1], "--progress") == 0) {
+        // Dropping the arguments, the interval too when it is given.
+        if (argc > 2 && argv[2][0] >= '0' && argv[2][0] <= '9') {
+            progressMs = atoi(argv[2]);
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+        }
+        else {
+            progressMs = PROGRESS_DEFAULT_MS;
+            argv[1] = argv[0];
+            argv += 1;
+            argc -= 1;
+        }
+        if (progressMs < 1 || argc < 2 || strcmp(argv[1], "--tournament") != 0) {
+            printf("Usage: %s --progress [ms] --tournament [games] [players] [random,greedy] [threads] [seed]\n", argv[0]);
+            return ERROR_INVALID;
+        }
+    }
+
+    // Usage: --simulate [games] [players] [random | greedy | ismcts[:ms[:threads]]] [seed]
+    if (argc > 1 && strcmp(argv[1], "--simulate") == 0) {
+        if (argc > 2)
+            numOfGames = atoi(argv[2]);
+        if (argc > 3)
+            numOfPlayers = atoi(argv[3]);
+        if (argc > 4)
+            strategyName = argv[4];
+        if (argc > 5)
+            seed = strtoull(argv[5], NULL, 10);
+
+        if (numOfGames < 1 || numOfPlayers < 1 || (recordTo != NULL && numOfPlayers > RECORD_MAX_PLAYERS)
+            || runSimulation(numOfGames, numOfPlayers, strategyName, seed, recordTo, traceTo, statsPath) != ERROR_OK) {
+            printf("Usage: %s --simulate [games] [players] [random | greedy | ismcts[:ms[:threads]]] [seed]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+    }
+
+    // Usage: --table [seats] [games] [random | greedy] [seed], one table with many seats
+    else if (argc > 1 && strcmp(argv[1], "--table") == 0) {
+        numOfPlayers = argc > 2 ? atoi(argv[2]) : TABLE_DEFAULT_SEATS;
+        numOfGames = argc > 3 ? atoi(argv[3]) : TABLE_DEFAULT_GAMES;
+        if (argc > 4)
+            strategyName = argv[4];
+        if (argc > 5)
+            seed = strtoull(argv[5], NULL, 10);
+        if (numOfGames < 1 || numOfPlayers < 1 || recordTo != NULL || traceTo != NULL
+            || runLargeTable(numOfPlayers, numOfGames, strategyName, seed, statsPath) != ERROR_OK) {
+            printf("Usage: %s --table [seats] [games] [random | greedy] [seed]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+    }
+
+    // Usage: --batch [games] [players] [random | greedy] [seed] [lanes], the same games as --simulate played in lockstep
+    else if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        if (argc > 2)
+            numOfGames = atoi(argv[2]);
+        if (argc > 3)
+            numOfPlayers = atoi(argv[3]);
+        if (argc > 4)
+            strategyName = argv[4];
+        if (argc > 5)
+            seed = strtoull(argv[5], NULL, 10);
+        if (numOfGames < 1 || numOfPlayers < 1 || recordTo != NULL || traceTo != NULL || statsPath != NULL
+            || runBatch(numOfGames, numOfPlayers, strategyName, seed, argc > 6 ? atoi(argv[6]) : BATCH_DEFAULT_LANES) != ERROR_OK) {
+            printf("Usage: %s --batch [games] [players] [random | greedy] [seed] [lanes]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+    }
+
+    // Usage: --tournament [games] [players] [strategies] [threads] [seed], the strategies are comma separated i.e random,greedy,ismcts:20
+    else if (argc > 1 && strcmp(argv[1], "--tournament") == 0) {
+        if (argc > 2)
+            numOfGames = atoi(argv[2]);
+        if (argc > 3)
+            numOfPlayers = atoi(argv[3]);
+        if (argc > 6)
+            seed = strtoull(argv[6], NULL, 10);
+        // A tracer has a single producer, the games of a tournament are played on several threads.
+        if (numOfGames < 1 || numOfPlayers < 1 || traceTo != NULL
+            || runTournament(numOfGames, numOfPlayers, argc > 4 ? argv[4] : defaultStrategies,
+                argc > 5 ? atoi(argv[5]) : getCoreCount(), seed, recordTo, statsPath, progressMs) != ERROR_OK) {
+            printf("Usage: %s --tournament [games] [players] [random,greedy] [threads] [seed]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+    }
+
+    // Usage: --bench [games] [seed], prints the results as JSON
+    else if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        if (argc > 2)
+            numOfGames = atoi(argv[2]);
+        else
+            numOfGames = BENCH_DEFAULT_GAMES;
+        if (numOfGames < 1) {
+            printf("Usage: %s --bench [games] [seed]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+        else
+            runBenchmark(numOfGames, argc > 3 ? strtoull(argv[3], NULL, 10) : 1);
+    }
+
+    // Usage: --selftest [hands] [seed], checks the vector code of legalMask against the rules card by card
+    else if (argc > 1 && strcmp(argv[1], "--selftest") == 0) {
+        numOfGames = argc > 2 ? atoi(argv[2]) : SELFTEST_DEFAULT_HANDS;
+        if (numOfGames < 1) {
+            printf("Usage: %s --selftest [hands] [seed]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+        else
+            result = runSelfTest(numOfGames, argc > 3 ? strtoull(argv[3], NULL, 10) : 1);
+    }
+
+    // Usage: --replay <file> [scan | rerun], scan summarizes the recorded games, rerun plays them again and checks them against the record
+    else if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+        if (argc < 3 || runReplay(argv[2], argc > 3 ? argv[3] : "scan") != ERROR_OK) {
+            printf("Usage: %s --replay <file> [scan | rerun]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+    }
+
+    // Usage: [--players n] [--names a,b,...] [--strategies human,greedy,...] [--seed n] [--script file] [--config file]
+    //        [--layout cards | --live [cards]], an interactive game, what is not given is asked for
+    else {
+        initGameOptions(&options);
+        if (parseGameOptions(&options, argc, argv) != ERROR_OK) {
+            printf("Usage: %s [--players n] [--names a,b] [--strategies human,greedy] [--seed n] [--script file] [--config file]"
+                " [--layout cards | --live [cards]]\n", argv[0]);
+            result = ERROR_INVALID;
+        }
+        else
+            result = runInteractiveGame(&options, recordTo, traceTo);
+    }
+
+    if (recordTo != NULL)
+        closeRecordFile(recordTo);
+    if (traceTo != NULL)
+        closeTracer(traceTo);
+    return result;
+}